@@ -21,7 +21,7 @@ import array
 import string
 from math import sqrt
 
-from ROOT import TF2, TGraphErrors, TVirtualFitter
+from ROOT import TF2, TGraphErrors
 from uncertainties import ufloat
 
 import hdtv.ui
@@ -214,13 +214,13 @@ class _Efficiency:
         for i in range(self._numPars):
             self.parameter[i] = self.TF1.GetParameter(i)
 
-        # Get covariance matrix
-        tvf = TVirtualFitter.GetFitter()
-        ##        cov = tvf.GetCovarianceMatrix()
-        for i in range(self._numPars):
-            for j in range(self._numPars):
-                self.fCov[i][j] = tvf.GetCovarianceMatrixElement(i, j)
-        ##                 self.fCov[i][j] = cov[i * self._numPars + j]
+        # Get covariance matrix (from the fit result, as TVirtualFitter is not
+        # updated with ROOT's thread safety enabled)
+        fitresult = fitreturn.Get()
+        if fitresult:
+            for i in range(self._numPars):
+                for j in range(self._numPars):
+                    self.fCov[i][j] = fitresult.CovMatrix(i, j)
 
         return self.parameter
 
@@ -506,56 +506,6 @@ class CutHistogram(Histogram):
         return s
 
 
-class THnSparseWrapper:
-    """
-    Wrapper around a 2d THnSparse object, providing ProjectionX and
-    ProjectionY.
-    """
-
-    def __init__(self, hist):
-        if not (isinstance(hist, ROOT.THnSparse) and hist.GetNdimensions() == 2):
-            raise RuntimeError("Class needs a THnSparse histogram of dimension 2")
-        self.__dict__["_hist"] = hist
-
-    def __setattr__(self, name, value):
-        self.__dict__["_hist"].__setattr__(name, value)
-
-    def __getattr__(self, name):
-        return getattr(self.__dict__["_hist"], name)
-
-    def GetXaxis(self):
-        return self._hist.GetAxis(0)
-
-    def GetYaxis(self):
-        return self._hist.GetAxis(1)
-
-    def ProjectionX(self, name, b1, b2, opt):
-        a = self._hist.GetAxis(1)
-        if b1 > b2:
-            a.SetRange(0, a.GetNbins())
-        else:
-            a.SetRange(b1, b2)
-
-        proj = self._hist.Projection(0, opt)
-        a.SetRange(0, a.GetNbins())
-
-        proj.SetName(name)
-        return proj
-
-    def ProjectionY(self, name, b1, b2, opt):
-        a = self._hist.GetAxis(0)
-        if b1 > b2:
-            a.SetRange(0, a.GetNbins())
-        else:
-            a.SetRange(b1, b2)
-
-        proj = self._hist.Projection(1, opt)
-        a.SetRange(0, a.GetNbins())
-
-        proj.SetName(name)
-        return proj
-
-
 class Histo2D:
     def __init__(self):
         pass
@@ -675,6 +625,96 @@ class RHisto2D(Histo2D):
         return hist
 
 
+class SparseHisto2D(Histo2D):
+    """
+    THnSparse-backed matrix for projection
+
+    Cuts and projections are done on a compressed sparse copy of the matrix
+    (SparseMatrix), so the matrix is never converted to a dense histogram.
+    """
+
+    def __init__(self, rhist):
+        if not (isinstance(rhist, ROOT.THnSparse) and rhist.GetNdimensions() == 2):
+            raise RuntimeError("Class needs a THnSparse histogram of dimension 2")
+        self.rhist = rhist
+
+        # Lazy generation of the sparse matrices, keyed by projection axis
+        self._vmatrices = {}
+
+    @property
+    def name(self):
+        return self.rhist.GetName()
+
+    def GetVMatrix(self, axis):
+        """
+        Return the sparse VMatrix projecting onto the given axis
+        """
+        if axis not in self._vmatrices:
+            if axis == "x":
+                paxis = ROOT.SparseMatrix.PROJ_X
+            else:
+                paxis = ROOT.SparseMatrix.PROJ_Y
+            self._vmatrices[axis] = ROOT.SparseMatrix(self.rhist, paxis)
+        return self._vmatrices[axis]
+
+    def _project(self, axis):
+        name = self.rhist.GetName() + "_pr" + axis
+        rhist = self.GetVMatrix(axis).Projection(name, name)
+        # Ensure proper garbage collection for ROOT histogram objects
+        ROOT.SetOwnership(rhist, True)
+        proj = Histogram(rhist)
+        proj.typeStr = axis + " projection"
+        return proj
+
+    @property
+    def xproj(self):
+        return self._project("x")
+
+    @property
+    def yproj(self):
+        return self._project("y")
+
+    def ExecuteCut(self, regionMarkers, bgMarkers, axis):
+        # _axis_ is the axis the markers refer to, so we project on the *other*
+        # axis. If the matrix is symmetric, this does not matter, so _axis_ is
+        # "0" and the implementation can choose.
+
+        if len(regionMarkers) < 1:
+            raise RuntimeError("Need at least one gate for cut")
+
+        if axis == "0":
+            axis = "x"
+
+        if axis not in ("x", "y"):
+            raise ValueError("Bad value for axis parameter")
+
+        if axis == "x":
+            matrix = self.GetVMatrix("y")
+        else:
+            matrix = self.GetVMatrix("x")
+
+        matrix.ResetRegions()
+
+        for r in regionMarkers:
+            b1 = matrix.FindCutBin(r.p1.pos_uncal)
+            b2 = matrix.FindCutBin(r.p2.pos_uncal)
+            matrix.AddCutRegion(b1, b2)
+
+        for b in bgMarkers:
+            b1 = matrix.FindCutBin(b.p1.pos_uncal)
+            b2 = matrix.FindCutBin(b.p2.pos_uncal)
+            matrix.AddBgRegion(b1, b2)
+
+        name = self.rhist.GetName() + "_cut"
+        rhist = matrix.Cut(name, name)
+        # Ensure proper garbage collection for ROOT histogram objects
+        ROOT.SetOwnership(rhist, True)
+
+        hist = CutHistogram(rhist, axis, regionMarkers)
+        hist.typeStr = "cut"
+        return hist
+
+
 class MHisto2D(Histo2D):
     """
     MFile-backed matrix for projection
@@ -688,10 +728,6 @@ class MHisto2D(Histo2D):
             hdtv.ui.error(str(error))
             raise
 
-        self.GenerateFiles(fname, sym)
-
-        basename = self.GetBasename(fname)
-
         # call to SpecReader to get the hist
         try:
             self.vmatrix = SpecReader.GetVMatrix(fname)
@@ -699,18 +735,36 @@ class MHisto2D(Histo2D):
             hdtv.ui.error(str(msg))
             raise
 
+        # Matrices stored as a triangle are always symmetric
+        if not sym and self.vmatrix.IsSymmetric():
+            hdtv.ui.info("%s is stored as a triangle, treating it as symmetric" % fname)
+            sym = True
+        self.sym = sym
+
+        self.GenerateFiles(fname, sym)
+
+        basename = self.GetBasename(fname)
+
         self._xproj = FileHistogram(basename + ".prx")
         self._xproj.typeStr = "Projection"
 
         if sym:
             self._yproj = None
-            self.tvmatrix = self.vmatrix  # Fixme
+            # Cuts on either axis are the same
+            self.tvmatrix = self.vmatrix
         else:
             self._yproj = FileHistogram(basename + ".pry")
             self._yproj.typeStr = "Projection"
 
+            # Cuts on the x axis read columns of the matrix, unless a
+            # transposed copy (from older versions) is lying around
+            trans_fname = basename + ".tmtx"
             try:
-                self.tvmatrix = SpecReader.GetVMatrix(basename + ".tmtx")
+                if os.path.exists(trans_fname):
+                    hdtv.ui.info("Using %s for transpose" % trans_fname)
+                    self.tvmatrix = SpecReader.GetVMatrix(trans_fname)
+                else:
+                    self.tvmatrix = SpecReader.GetVMatrix(fname, columns=True)
             except SpecReaderError as msg:
                 hdtv.ui.error(str(msg))
                 raise
@@ -785,8 +839,8 @@ class MHisto2D(Histo2D):
 
     def GenerateFiles(self, fname, sym):
         """
-        Generate projection(s) and possibly transpose (for asymmetric matrices),
-        if they do not exist yet.
+        Generate projection(s), if they do not exist yet. No transposed copy
+        is needed, since cuts on the x axis read the matrix column-wise.
         """
         basename = self.GetBasename(fname)
 
@@ -812,14 +866,3 @@ class MHisto2D(Histo2D):
                 hdtv.ui.info("Generated x projection: %s" % prx_fname)
             if pry_fname:
                 hdtv.ui.info("Generated y projection: %s" % pry_fname)
-
-        # Generate transpose
-        if not sym:
-            trans_fname = basename + ".tmtx"
-            if os.path.exists(trans_fname):
-                hdtv.ui.info("Using %s for transpose" % trans_fname)
-            else:
-                errno = ROOT.MatOp.Transpose(fname, trans_fname)
-                if errno != ROOT.MatOp.ERR_SUCCESS:
-                    raise RuntimeError("Transpose: " + ROOT.MatOp.GetErrorString(errno))
-                hdtv.ui.info("Generated transpose: %s" % trans_fname)
@@ -52,7 +52,7 @@ class PeakModel:
                 sep = ""
                 for stat in status:
                     statstr += sep
-                    if stat in ("free", "equal", "hold", "none", "calculated"):
+                    if stat in ("free", "equal", "hold", "none", "calculated", "model"):
                         statstr += stat
                     else:
                         statstr += "%.3f" % stat
@@ -71,6 +71,8 @@ class PeakModel:
                     statstr += "%s: none (disabled)\n" % name
                 elif status == "calculated":
                     statstr += "%s: calculated from fit result\n" % name
+                elif status == "model":
+                    statstr += "%s: from width model\n" % name
                 else:
                     statstr += f"{name}: fixed at {status:.3f}\n"
 
@@ -191,7 +193,8 @@ class PeakModel:
                 return ROOT.HDTV.Fit.Param.Fixed()
             else:
                 return ROOT.HDTV.Fit.Param.Fixed(ival)
-        elif parStatus == "none":
+        elif parStatus in ("none", "model"):
+            # For "model", the value is provided by the fitter's width model
             return ROOT.HDTV.Fit.Param.Empty()
         elif isinstance(parStatus, float):
             return ROOT.HDTV.Fit.Param.Fixed(
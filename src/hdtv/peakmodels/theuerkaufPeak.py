@@ -180,7 +180,7 @@ class PeakModelTheuerkauf(PeakModel):
         self.fValidParStatus = {
             "pos": [float, "free", "hold"],
             "vol": [float, "free", "hold"],
-            "width": [float, "free", "equal"],
+            "width": [float, "free", "equal", "model"],
             "tl": [float, "free", "equal", "none"],
             "tr": [float, "free", "equal", "none"],
             "sh": [float, "free", "equal", "none"],
@@ -190,11 +190,19 @@ class PeakModelTheuerkauf(PeakModel):
             "integrate": False,
             "likelihood": "normal",
             "onlypositivepeaks": False,
+            "varpro": False,
+            "fwhm_a": "free",
+            "fwhm_b": "free",
+            "fwhm_c": 0.0,
         }
         self.fValidOptStatus = {
             "integrate": [False, True],
             "likelihood": ["normal", "poisson"],
             "onlypositivepeaks": [False, True],
+            "varpro": [False, True],
+            "fwhm_a": [float, "free"],
+            "fwhm_b": [float, "free"],
+            "fwhm_c": [float, "free"],
         }
 
         self.ResetParamStatus()
@@ -278,6 +286,10 @@ class PeakModelTheuerkauf(PeakModel):
         self.fOptStatus["integrate"] = False
         self.fOptStatus["likelihood"] = "normal"
         self.fOptStatus["onlypositivepeaks"] = False
+        self.fOptStatus["varpro"] = False
+        self.fOptStatus["fwhm_a"] = "free"
+        self.fOptStatus["fwhm_b"] = "free"
+        self.fOptStatus["fwhm_c"] = 0.0
 
     def Uncal(self, parname, value, pos_uncal, cal):
         """
@@ -299,6 +311,27 @@ class PeakModelTheuerkauf(PeakModel):
         else:
             raise RuntimeError("Unexpected parameter name")
 
+    def GetWidthModel(self, region, cal):
+        """
+        Return a HDTV.Fit.WidthModel object with the coefficients given by the
+        fwhm_a, fwhm_b and fwhm_c options. They refer to calibrated units, with
+        the calibration linearized over the fit region.
+        """
+        center = (region[0] + region[1]) / 2.0
+        if cal is None:
+            offset, slope = 0.0, 1.0
+        else:
+            slope = cal.dEdCh(center)
+            offset = cal.Ch2E(center) - slope * center
+        coeffs = []
+        for name in ("fwhm_a", "fwhm_b", "fwhm_c"):
+            status = self.fOptStatus[name]
+            if status == "free":
+                coeffs.append(self.fFitter.AllocParam())
+            else:
+                coeffs.append(ROOT.HDTV.Fit.Param.Fixed(status))
+        return ROOT.HDTV.Fit.WidthModel(*coeffs, offset, slope)
+
     def GetFitter(self, region, peaklist, cal):
         """
         Creates a C++ Fitter object, which can then do the real work
@@ -310,14 +343,29 @@ class PeakModelTheuerkauf(PeakModel):
         integrate = self.GetOption("integrate")
         likelihood = self.GetOption("likelihood")
         onlypositivepeaks = self.GetOption("onlypositivepeaks")
+        # Solve for volumes and internal background exactly, and let Minuit
+        # search only the remaining parameters (variable projection)
+        varpro = self.GetOption("varpro")
         self.fFitter = ROOT.HDTV.Fit.TheuerkaufFitter(
-            region[0], region[1], integrate, likelihood, onlypositivepeaks
+            region[0],
+            region[1],
+            integrate,
+            likelihood,
+            onlypositivepeaks,
+            False,  # debugShowInipar
+            varpro,
         )
         self.ResetGlobalParams()
         # Check if enough values are provided in case of per-peak parameters
         #  (the function raises a RuntimeError if the check fails)
         self.CheckParStatusLen(len(peaklist))
 
+        # Peaks with width status "model" take their width from
+        #  fwhm(E) = sqrt(a + b*E + c*E^2), which has to be set up first
+        width = self.fParStatus["width"]
+        if width == "model" or (isinstance(width, list) and "model" in width):
+            self.fFitter.SetWidthModel(self.GetWidthModel(region, cal))
+
         # Copy peaks to the fitter
         for pid in range(len(peaklist)):
             pos_uncal = peaklist[pid]
@@ -17,6 +17,7 @@
 # along with HDTV; if not, write to the Free Software Foundation,
 # Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
 
+import math
 from html import escape
 
 import ROOT
@@ -65,6 +66,13 @@ class FitInterface:
             "fit.list.show_pos_lit_residuals", self.opt["list.show_pos_lit_residuals"]
         )
 
+        self.opt["profile"] = hdtv.options.Option(
+            default=False,
+            parse=hdtv.options.parse_bool,
+            changeCallback=lambda x: ROOT.HDTV.Fit.FitStats.EnableProfile(x),
+        )
+        hdtv.options.RegisterOption("fit.profile", self.opt["profile"])
+
         if self.window:
             self._register_hotkeys()
 
@@ -315,6 +323,74 @@ class FitInterface:
         if fit.spec is not None:
             hdtv.ui.msg(html=str(fit))
 
+    def BootstrapWorkFit(self, nreplicas, parametric=False, seed=0, threads=0):
+        """
+        Estimate the uncertainties of the peaks of the workFit by refitting
+        resampled spectra, and print mean, standard deviation and central
+        intervals (68% and 95%) of the parameters as a table
+        """
+        fit = self.spectra.workFit
+        peakFitter = fit.fitter.peakFitter
+        if fit.spec is None or peakFitter is None or not peakFitter.IsFinal():
+            raise hdtv.cmdline.HDTVCommandError("WorkFit has not been fitted")
+        if fit.fitter.peakModel.name != "theuerkauf":
+            raise hdtv.cmdline.HDTVCommandError(
+                "Bootstrap is only available for the theuerkauf peak model"
+            )
+
+        Bootstrap = ROOT.HDTV.Fit.Bootstrap
+        mode = Bootstrap.kParametric if parametric else Bootstrap.kPoisson
+        boot = Bootstrap(peakFitter, fit.spec.hist.hist, mode)
+        nconverged = boot.Run(nreplicas, seed, threads)
+        if nconverged < 2:
+            raise hdtv.cmdline.HDTVCommandError("Too few replica fits converged")
+
+        # Values are converted to calibrated units like the fit results,
+        #  assuming that the calibration is linear over the spread of values
+        cal = fit.cal
+        objects = []
+        quantiles = (0.025, 0.16, 0.84, 0.975)
+        fwhm = 2.0 * math.sqrt(2.0 * math.log(2.0))
+        for pid in range(peakFitter.GetNumPeaks()):
+            pos = peakFitter.GetPeak(pid).GetPos()
+            slope = 1.0 if cal is None else abs(cal.dEdCh(pos))
+            for name in ("pos", "vol", "width"):
+                mean = boot.GetMean(pid, name)
+                stddev = boot.GetStdDev(pid, name)
+                values = [boot.GetPercentile(pid, name, q) for q in quantiles]
+                if name == "pos" and cal is not None:
+                    mean = cal.Ch2E(mean)
+                    stddev *= slope
+                    values = [cal.Ch2E(value) for value in values]
+                elif name == "width":
+                    mean *= slope * fwhm
+                    stddev *= slope * fwhm
+                    values = [value * slope * fwhm for value in values]
+                objects.append(
+                    {
+                        "id": pid,
+                        "param": name,
+                        "mean": "%.6g" % mean,
+                        "stddev": "%.3g" % stddev,
+                        "68%": "[%.6g, %.6g]" % (values[1], values[2]),
+                        "95%": "[%.6g, %.6g]" % (values[0], values[3]),
+                    }
+                )
+
+        header = "Bootstrap of WorkFit on spectrum: %s (%s)" % (
+            fit.spec.ID,
+            fit.spec.name,
+        )
+        footer = "\n%d of %d replica fits converged" % (nconverged, nreplicas)
+        table = hdtv.util.Table(
+            objects,
+            ["id", "param", "mean", "stddev", "68%", "95%"],
+            extra_header=header,
+            extra_footer=footer,
+        )
+        hdtv.ui.msg(html=str(table))
+        return objects
+
     def PrintWorkFitIntegral(self):
         """
         Print integral of workFit range as nice table
@@ -426,8 +502,39 @@ class FitInterface:
                 )
             statstr += "<b>Peak model:</b> %s\n" % fitter.peakModel.name
             statstr += fitter.OptionsStr()
+            for name, sub in (
+                ("Peak fit", fitter.peakFitter),
+                ("Background fit", fitter.bgFitter),
+            ):
+                if sub is None:
+                    continue
+                stats = sub.GetFitStats()
+                if stats.GetNumMinimizations() == 0:
+                    continue
+                statstr += "<b>%s:</b> " % name
+                statstr += "%d evaluations, status %d, edm %.3g, %.1f ms\n" % (
+                    stats.GetNumCalls(),
+                    stats.GetStatus(),
+                    stats.GetEdm(),
+                    1000.0 * stats.GetWallTime(),
+                )
         hdtv.ui.msg(html=statstr)
 
+    def ShowProfile(self, reset=False, filename=None):
+        """
+        Show the evaluations and time spent in fits, summed up by kind of fitter
+        since the option fit.profile was enabled
+        """
+        if not self.opt["profile"].value:
+            hdtv.ui.warning("Profiling is disabled, set fit.profile to True")
+        profile = str(ROOT.HDTV.Fit.FitStats.GetProfile())
+        hdtv.ui.msg(profile, end="")
+        if filename is not None:
+            with open(filename, "w") as f:
+                f.write(profile)
+        if reset:
+            ROOT.HDTV.Fit.FitStats.ResetProfile()
+
     def SetFitterParameter(self, parname, status, ids=None):
         """
         Sets status of fitter parameter
@@ -687,6 +794,61 @@ class TvFitInterface:
             prog, self.FitMarkerChange, parser=parser, completer=self.MarkerCompleter
         )
 
+        prog = "fit bootstrap"
+        description = "estimate uncertainties of the work fit by refitting resampled spectra"
+        parser = hdtv.cmdline.HDTVOptionParser(prog=prog, description=description)
+        parser.add_argument(
+            "-n",
+            "--replicas",
+            action="store",
+            default=200,
+            type=int,
+            help="number of resampled spectra (default: %(default)s)",
+        )
+        parser.add_argument(
+            "-p",
+            "--parametric",
+            action="store_true",
+            default=False,
+            help="fluctuate the fitted model instead of the measured counts",
+        )
+        parser.add_argument(
+            "--seed",
+            action="store",
+            default=0,
+            type=int,
+            help="seed of the random number generator (default: %(default)s)",
+        )
+        parser.add_argument(
+            "-j",
+            "--threads",
+            action="store",
+            default=0,
+            type=int,
+            help="number of threads (default: one per core)",
+        )
+        hdtv.cmdline.AddCommand(prog, self.FitBootstrap, parser=parser)
+
+        prog = "fit profile"
+        description = "show evaluations and time spent in fits (option fit.profile)"
+        parser = hdtv.cmdline.HDTVOptionParser(prog=prog, description=description)
+        parser.add_argument(
+            "-r",
+            "--reset",
+            action="store_true",
+            default=False,
+            help="reset the profile after showing it",
+        )
+        parser.add_argument(
+            "-w",
+            "--write",
+            action="store",
+            default=None,
+            metavar="FILE",
+            help="also write the profile to FILE",
+        )
+        hdtv.cmdline.AddCommand(prog, self.FitProfile, parser=parser)
+
         prog = "fit clear"
         description = "clear the active work fit"
         parser = hdtv.cmdline.HDTVOptionParser(prog=prog, description=description)
@@ -1094,6 +1256,22 @@ class TvFitInterface:
             self.spectra.ActivateObject(oldActiveID)
         return None
 
+    def FitBootstrap(self, args):
+        """
+        Bootstrap the uncertainties of the work fit
+        """
+        if args.replicas < 2:
+            raise hdtv.cmdline.HDTVCommandError("Need at least two replicas")
+        self.fitIf.BootstrapWorkFit(
+            args.replicas, args.parametric, args.seed, args.threads
+        )
+
+    def FitProfile(self, args):
+        """
+        Show the fit profile
+        """
+        self.fitIf.ShowProfile(args.reset, args.write)
+
     def FitClear(self, args):
         """
         Clear work fit
@@ -170,6 +170,7 @@ class MatInterface:
             hdtv.ui.warning("Could not load %s" % fname)
             return
 
+        sym = histo.sym
         matrix = Matrix(histo, sym, self.spectra.viewport)
         proj = matrix.xproj
         ID = self.spectra.GetFreeID()
@@ -305,6 +306,33 @@ class TvMatInterface:
             "filename", metavar="matrix-file", help="file with matrix to load"
         )
         parser.add_argument("format", nargs="?", default=None, help="format of matrix")
+        parser.add_argument(
+            "-x",
+            "--xwindow",
+            nargs=2,
+            type=int,
+            metavar=("START", "END"),
+            default=None,
+            help="only load columns START to END (channels, inclusive)",
+        )
+        parser.add_argument(
+            "-y",
+            "--ywindow",
+            nargs=2,
+            type=int,
+            metavar=("START", "END"),
+            default=None,
+            help="only load lines START to END (channels, inclusive)",
+        )
+        parser.add_argument(
+            "-r",
+            "--rebin",
+            nargs=2,
+            type=int,
+            metavar=("XGROUP", "YGROUP"),
+            default=(1, 1),
+            help="sum XGROUP x YGROUP channels into one bin while loading",
+        )
         hdtv.cmdline.AddCommand(
             prog, self.MatrixView, level=0, fileargs=True, parser=parser
         )
@@ -366,7 +394,18 @@ class TvMatInterface:
         """
         Load a matrix from file, then display it in 2d
         """
-        hist = SpecReader.GetMatrix(args.filename, args.format)
+        xrebin, yrebin = args.rebin
+        try:
+            hist = SpecReader.GetMatrix(
+                args.filename,
+                args.format,
+                xwindow=args.xwindow,
+                ywindow=args.ywindow,
+                xrebin=xrebin,
+                yrebin=yrebin,
+            )
+        except SpecReaderError as msg:
+            raise hdtv.cmdline.HDTVCommandError(str(msg))
 
         title = hist.GetTitle()
         viewer = ROOT.HDTV.Display.MTViewer(400, 400, hist, title)
@@ -33,7 +33,7 @@ import hdtv.ui
 
 class PeakFinder:
     """
-    Automatic peak finder - using ROOTS peak search function
+    Automatic peak finder - using the peak search of the fit library
     """
 
     def __init__(self, spectra):
@@ -45,8 +45,8 @@ class PeakFinder:
     ):
         self.spec = self.spectra.dict[sid]
         self.sigma_E = sigma
-        peaks = self.PeakSearch(sigma, threshold, start, end)
-        num = self.StoreFits(peaks, autofit, reject)
+        groups = self.PeakSearch(sigma, threshold, start, end)
+        num = self.StoreFits(groups, autofit, reject)
         hdtv.ui.msg("Found " + str(num) + " peaks")
         # remove reference to spec otherwise we get trouble with garbage
         # collection
@@ -55,14 +55,14 @@ class PeakFinder:
     def PeakSearch(self, sigma, threshold, start=None, end=None):
         """
         Search for peaks
+
+        Returns the multiplets found, sorted by position, as a list of tuples
+        of the fit region and the peak positions (all in channels)
         """
         sigma_E = sigma
+        assert sigma_E > 0, "Sigma must be > 0"
 
-        tSpec = ROOT.TSpectrum()
-
-        # Copy underlying ROOT hist here so we can safely modify ranges, etc.
-        # below
-        hist = copy.copy(self.spec.hist).hist
+        hist = self.spec.hist.hist
 
         # Init start and end region
         if start is None:
@@ -77,58 +77,46 @@ class PeakFinder:
             end_E = end
             end_Ch = self.spec.cal.E2Ch(end_E)
 
-        # good approximation of sigma_Ch
-        sigma_Ch = self.spec.cal.E2Ch(sigma) - self.spec.cal.E2Ch(0.0)
-        assert sigma_Ch > 0, "Sigma must be > 0"
-
         text = "Search Peaks in region "
         text += str(start_E) + "--" + str(end_E)
         text += " (sigma=" + str(sigma_E)
         text += " threshold=" + str(threshold * 100) + "%)"
         hdtv.ui.msg(text)
 
-        # Invoke ROOT's peak finder
-        hist.SetAxisRange(start_Ch, end_Ch)
-        num_peaks = tSpec.Search(hist, sigma_Ch, "goff", threshold)
-        foundpeaks = tSpec.GetPositionX()
-
-        # Sort by position
-        tmp = []
-        for i in range(num_peaks):
-            tmp.append(foundpeaks[i])  # convert from array to list
-        tmp.sort()
-        foundpeaks = tmp
-
-        return foundpeaks
-
-    def StoreFits(self, foundpeaks, autofit=False, reject=False):
+        # The peak finder converts sigma to channels along the calibration
+        finder = ROOT.HDTV.Fit.PeakFinder(sigma_E, threshold)
+        finder.SetCalibration(self.spec.cal)
+        finder.Search(hist, start_Ch, end_Ch)
+
+        groups = []
+        for i in range(finder.GetNumGroups()):
+            group = finder.GetGroup(i)
+            positions = [
+                finder.GetPeak(group.GetFirst() + k).GetPos()
+                for k in range(group.GetNumPeaks())
+            ]
+            groups.append(((group.GetMin(), group.GetMax()), positions))
+        return groups
+
+    def StoreFits(self, groups, autofit=False, reject=False):
         """
-        Create fit objects from peak positions and add them to the fitlist
-        If autofit is set to True fitting is done,
-        if reject is set to True all badFits will be remove.
+        Create fit objects from the multiplets found and add them to the
+        fitlist. If autofit is set to True, each multiplet is fitted in the
+        region found for it, if reject is set to True all badFits will be
+        removed. Without autofit, a fit is created for each peak.
         """
+        if not autofit:
+            groups = [(None, [p]) for _, positions in groups for p in positions]
+
         peak_count = 0
-        while len(foundpeaks) > 0:
-            p = foundpeaks.pop(0)
+        for region, positions in groups:
             fitter = copy.copy(self.spectra.workFit.fitter)
             fit = hdtv.fit.Fit(fitter, cal=self.spec.cal)
-            pos_E = self.spec.cal.Ch2E(p)
-            fit.ChangeMarker("peak", pos_E, action="set")
+            for p in positions:
+                fit.ChangeMarker("peak", self.spec.cal.Ch2E(p), action="set")
             if autofit:
-                region_width = self.sigma_E * 5.0  # TODO: something sensible here
-                # left region marker
-                fit.ChangeMarker("region", pos_E - region_width / 2.0, action="set")
-                limit = pos_E + region_width
-                # collect multipletts
-                while (
-                    len(foundpeaks) > 0 and self.spec.cal.Ch2E(foundpeaks[0]) <= limit
-                ):
-                    next = foundpeaks.pop(0)
-                    pos_E = self.spec.cal.Ch2E(next)
-                    limit = pos_E + region_width
-                    fit.ChangeMarker("peak", pos_E, "set")
-                # right region marker
-                fit.ChangeMarker("region", pos_E + region_width / 2.0, "set")
+                for r in region:
+                    fit.ChangeMarker("region", self.spec.cal.Ch2E(r), action="set")
                 fit.FitPeakFunc(self.spec)  # , silent = True
                 # check fits
                 result = self.BadFit(fit)
@@ -32,7 +32,7 @@ import hdtv.rootext.display
 import hdtv.tabformat
 import hdtv.ui
 import hdtv.util
-from hdtv.histogram import Histogram, RHisto2D, THnSparseWrapper
+from hdtv.histogram import Histogram, RHisto2D, SparseHisto2D
 from hdtv.matrix import Matrix
 from hdtv.spectrum import Spectrum
 
@@ -346,7 +346,7 @@ class RootFileInterface:
         if isinstance(rhist, ROOT.TH2):
             hist = RHisto2D(rhist)
         elif isinstance(rhist, ROOT.THnSparse):
-            hist = RHisto2D(THnSparseWrapper(rhist))
+            hist = SparseHisto2D(rhist)
         else:
             raise RuntimeError
 
@@ -70,7 +70,30 @@ public:
       return ch;
     }
 
-    return std::accumulate(fCal.rbegin(), fCal.rend(), 0.0, [ch](double E, double coeff) { return (E * ch) + coeff; });
+    return Horner(fCal, ch);
+  }
+
+  //! Convert n channels to energies. Same as calling Ch2E(double) for each
+  //! point, but the loop over the points is innermost, so it can be vectorized.
+  //! ch and e must not overlap.
+  void Ch2E(const double *ch, double *e, std::size_t n) const {
+    if (fCal.empty()) {
+      std::copy(ch, ch + n, e);
+      return;
+    }
+
+    std::fill(e, e + n, fCal.back());
+    for (auto coeff = fCal.rbegin() + 1; coeff != fCal.rend(); ++coeff) {
+      for (std::size_t i = 0; i < n; i++) {
+        e[i] = e[i] * ch[i] + *coeff;
+      }
+    }
+  }
+
+  std::vector<double> Ch2E(const std::vector<double> &ch) const {
+    std::vector<double> e(ch.size());
+    Ch2E(ch.data(), e.data(), ch.size());
+    return e;
   }
 
   //! Calculate the slope of the calibration function \frac{dE}{dCh}, at position ch
@@ -80,8 +103,7 @@ public:
       return 1.0;
     }
 
-    return std::accumulate(fCalDeriv.rbegin(), fCalDeriv.rend(), 0.0,
-                           [ch](double slope, double coeff) { return (slope * ch) + coeff; });
+    return Horner(fCalDeriv, ch);
   }
 
   //! Convert an energy to a channel, using the chosen energy calibration.
@@ -92,22 +114,40 @@ public:
       return e;
     }
 
-    double ch = 1.0;
-    double de = Ch2E(ch) - e;
-    const double _e = std::max(std::abs(e), 1.0);
+    return SolveE2Ch(e, 1.0);
+  }
 
-    for (int i = 0; i < 10 && std::abs(de / _e) > 1e-10; i++) {
-      // Calculate the slope
-      const double slope = std::accumulate(fCalDeriv.rbegin(), fCalDeriv.rend(), 0.0,
-                                           [ch](double slope, double coeff) { return (slope * ch) + coeff; });
-      ch -= de / slope;
-      de = Ch2E(ch) - e;
+  //! Convert n energies to channels. The solver for each point starts from the
+  //! result of the previous one, so for ordered, closely spaced energies (e.g.
+  //! one per pixel on screen) it usually converges in one or two steps.
+  //! e and ch may be the same array.
+  void E2Ch(const double *e, double *ch, std::size_t n) const {
+    if (fCal.empty()) {
+      // std::copy does not allow the destination to start inside the source
+      if (e != ch) {
+        std::copy(e, e + n, ch);
+      }
+      return;
     }
 
-    if (std::abs(de / _e) > 1e-10) {
-      std::cout << "Warning: Solver failed to converge in Calibration::E2Ch()." << std::endl;
+    // The inverse of a linear calibration needs no iteration
+    if (fCal.size() <= 2) {
+      const double slope = fCal.size() == 2 ? fCal[1] : 0.0;
+      for (std::size_t i = 0; i < n; i++) {
+        ch[i] = (e[i] - fCal[0]) / slope;
+      }
+      return;
+    }
+
+    double seed = 1.0;
+    for (std::size_t i = 0; i < n; i++) {
+      ch[i] = seed = SolveE2Ch(e[i], seed);
     }
+  }
 
+  std::vector<double> E2Ch(const std::vector<double> &e) const {
+    std::vector<double> ch(e.size());
+    E2Ch(e.data(), ch.data(), e.size());
     return ch;
   }
 
@@ -120,11 +160,11 @@ public:
   }
 
   void Apply(TAxis *axis, int nbins) const {
+    auto channels = std::make_unique<double[]>(nbins);
     auto centers = std::make_unique<double[]>(nbins);
 
-    for (int i = 0; i < nbins; i++) {
-      centers[i] = Ch2E(i);
-    }
+    std::iota(channels.get(), channels.get() + nbins, 0.0);
+    Ch2E(channels.get(), centers.get(), nbins);
 
     axis->Set(nbins, centers.get());
   }
@@ -133,6 +173,31 @@ private:
   std::vector<double> fCal;
   std::vector<double> fCalDeriv;
 
+  static double Horner(const std::vector<double> &coeffs, double x) {
+    double y = 0.0;
+    for (auto coeff = coeffs.rbegin(); coeff != coeffs.rend(); ++coeff) {
+      y = y * x + *coeff;
+    }
+    return y;
+  }
+
+  //! Newton solver for Ch2E(ch) = e, starting at ch
+  double SolveE2Ch(double e, double ch) const {
+    double de = Ch2E(ch) - e;
+    const double _e = std::max(std::abs(e), 1.0);
+
+    for (int i = 0; i < 10 && std::abs(de / _e) > 1e-10; i++) {
+      ch -= de / Horner(fCalDeriv, ch);
+      de = Ch2E(ch) - e;
+    }
+
+    if (std::abs(de / _e) > 1e-10) {
+      std::cout << "Warning: Solver failed to converge in Calibration::E2Ch()." << std::endl;
+    }
+
+    return ch;
+  }
+
   void UpdateDerivative() {
     // Update the coefficients of the derivative polynomial
     fCalDeriv.clear();
@@ -59,6 +59,13 @@ public:
 
   int GetZIndex() const override { return Z_INDEX_FUNC; }
 
+  bool GetERange(Painter & /*painter*/, double &e1, double &e2, int &margin) override {
+    e1 = GetMinE();
+    e2 = GetMaxE();
+    margin = 1;
+    return true;
+  }
+
 private:
   TF1 *fFunc;
 };
@@ -46,7 +46,7 @@ void DisplayObj::Update(bool force) {
   }
 
   for (auto &stack : fStacks) {
-    stack->Update();
+    stack->Update(this);
   }
 }
 
@@ -71,13 +71,13 @@ void DisplayObj::Draw(DisplayStack *stack) {
                           [&zindex](const DisplayObj *obj) { return obj->GetZIndex() > zindex; });
   objects.insert(pos, this);
   fStacks.insert(fStacks.begin(), stack);
-  stack->Update();
+  stack->Update(this);
 }
 
 //! Remove the object from the display stack
 void DisplayObj::Remove(DisplayStack *stack) {
   stack->fObjects.remove(this);
-  stack->Update();
+  stack->Update(this, true);
   fStacks.remove(stack);
 }
 
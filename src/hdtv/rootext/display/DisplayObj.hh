@@ -72,6 +72,12 @@ public:
 
   virtual void PaintRegion(UInt_t /*x1*/, UInt_t /*x2*/, Painter & /*painter*/) {}
 
+  //! Get the energy range the object paints in, plus the number of pixels it
+  //! may extend beyond the upper end (e.g. for a label). Used to repaint only
+  //! the affected part of a view when the object changes. Returns false if
+  //! the object may affect the whole view (the default).
+  virtual bool GetERange(Painter & /*painter*/, double & /*e1*/, double & /*e2*/, int & /*margin*/) { return false; }
+
   virtual int GetZIndex() const { return Z_INDEX_MISC; }
 
   static const int DEFAULT_COLOR;
@@ -37,6 +37,7 @@ DisplaySpec::DisplaySpec(const TH1 *hist, int col)
     : DisplayBlock(col), fCachedMaxBin{0}, fCachedMax{0.0}, fDrawUnderflowBin(false), fDrawOverflowBin(false) {
 
   fHist.reset(dynamic_cast<TH1 *>(hist->Clone()));
+  BuildRegionTables();
 
   // cout << "GSDisplaySpec constructor" << endl;
 
@@ -50,43 +51,119 @@ void DisplaySpec::SetHist(const TH1 *hist) {
   //! Set the histogram owned by this object to a copy of hist
 
   fHist.reset(dynamic_cast<TH1 *>(hist->Clone()));
+  BuildRegionTables();
+
+  // Invalidate cache of GetMax_Cached()
+  fCachedB1 = 1;
+  fCachedB2 = 0;
+
   Update();
 }
 
+void DisplaySpec::BuildRegionTables() {
+  //! Build the tables used to find the maximum and minimum of a region in
+  //! O(log n). Level k of a table holds, for each block of 2^(k+1) bins, the
+  //! bin with the largest (smallest) content; ties go to the lower bin, as
+  //! with a linear search.
+
+  const int nbins = GetNbinsX() + 2;
+  fContents.resize(nbins);
+  for (int bin = 0; bin < nbins; bin++) {
+    fContents[bin] = fHist->GetBinContent(bin);
+  }
+
+  auto build = [this](std::vector<std::vector<int>> &table, auto better) {
+    table.clear();
+    int n = fContents.size();
+    const std::vector<int> *prev = nullptr;
+    while (n > 1) {
+      std::vector<int> level((n + 1) / 2);
+      for (int i = 0; i < n / 2; i++) {
+        int a = prev ? (*prev)[2 * i] : 2 * i;
+        int b = prev ? (*prev)[2 * i + 1] : 2 * i + 1;
+        level[i] = better(b, a) ? b : a;
+      }
+      if (n % 2) {
+        level[n / 2] = prev ? (*prev)[n - 1] : n - 1;
+      }
+      table.push_back(std::move(level));
+      prev = &table.back();
+      n = (n + 1) / 2;
+    }
+  };
+
+  build(fMaxTable, [this](int a, int b) { return fContents[a] > fContents[b]; });
+  build(fMinTable, [this](int a, int b) { return fContents[a] < fContents[b]; });
+}
+
+template <class Better>
+int DisplaySpec::FindRegionBin(const std::vector<std::vector<int>> &table, int b1, int b2, Better better) {
+  //! Walk up the table, collecting the blocks that exactly cover b1 ... b2
+
+  int best = b1;
+  auto consider = [&](int bin) {
+    if (better(bin, best) || (!better(best, bin) && bin < best)) {
+      best = bin;
+    }
+  };
+
+  // Level -1 are the bins themselves
+  int lo = b1, hi = b2;
+  for (int k = -1; lo <= hi; k++) {
+    if (lo % 2) {
+      consider(k < 0 ? lo : table[k][lo]);
+      lo++;
+    }
+    if (!(hi % 2)) {
+      consider(k < 0 ? hi : table[k][hi]);
+      hi--;
+    }
+    lo /= 2;
+    hi = (hi - 1) / 2;
+  }
+
+  return best;
+}
+
 int DisplaySpec::GetRegionMaxBin(int b1, int b2) {
   //! Find the bin number of the bin between b1 and b2 (inclusive) which
   //! contains the most events
   //! b1 and b2 are raw bin numbers
   //! The region is clipped according to fDrawUnderflowBin and fDrawOverflowBin
 
-  int bin, max_bin;
-  double y, max_y;
-
   b1 = ClipBin(b1);
   b2 = ClipBin(b2);
-
-  max_y = fHist->GetBinContent(b1);
-  max_bin = b1;
-
-  for (bin = b1; bin <= b2; bin++) {
-    y = fHist->GetBinContent(bin);
-    if (y > max_y) {
-      max_y = y;
-      max_bin = bin;
-    }
+  if (b2 <= b1) {
+    return b1;
   }
 
-  return max_bin;
+  return FindRegionBin(fMaxTable, b1, b2, [this](int a, int b) { return fContents[a] > fContents[b]; });
 }
 
 double DisplaySpec::GetRegionMax(int b1, int b2) {
   //! Get the maximum counts in the region between bin b1 and bin b2 (inclusive)
   //! b1 and b2 are raw bin numbers
 
-  int max_bin = GetRegionMaxBin(b1, b2);
+  return fContents[GetRegionMaxBin(b1, b2)];
+}
+
+int DisplaySpec::GetRegionMinBin(int b1, int b2) {
+  //! Find the bin number of the bin between b1 and b2 (inclusive) which
+  //! contains the fewest events (see GetRegionMaxBin())
+
+  b1 = ClipBin(b1);
+  b2 = ClipBin(b2);
+  if (b2 <= b1) {
+    return b1;
+  }
+
+  return FindRegionBin(fMinTable, b1, b2, [this](int a, int b) { return fContents[a] < fContents[b]; });
+}
+
+double DisplaySpec::GetRegionMin(int b1, int b2) {
+  //! Get the minimum counts in the region between bin b1 and bin b2 (inclusive)
 
-  // return max_bin == -1 ? 0.0 : fHist->GetBinContent(max_bin);
-  return fHist->GetBinContent(max_bin);
+  return fContents[GetRegionMinBin(b1, b2)];
 }
 
 double DisplaySpec::GetMax_Cached(int b1, int b2) {
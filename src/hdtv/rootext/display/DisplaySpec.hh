@@ -25,6 +25,7 @@
 
 #include <memory>
 #include <sstream>
+#include <vector>
 
 #include <TH1.h>
 
@@ -44,6 +45,8 @@ public:
 
   int GetRegionMaxBin(int b1, int b2);
   double GetRegionMax(int b1, int b2);
+  int GetRegionMinBin(int b1, int b2);
+  double GetRegionMin(int b1, int b2);
 
   void SetID(int ID) {
     fID = std::to_string(ID);
@@ -104,8 +107,16 @@ public:
   int GetZIndex() const override { return Z_INDEX_SPEC; }
 
 private:
+  void BuildRegionTables();
+  template <class Better> int FindRegionBin(const std::vector<std::vector<int>> &table, int b1, int b2, Better better);
+
   std::unique_ptr<TH1> fHist;
 
+  // Copy of the bin contents (including under- and overflow bin) and, for
+  // level k, the bin of the maximum (minimum) of each block of 2^(k+1) bins
+  std::vector<double> fContents;
+  std::vector<std::vector<int>> fMaxTable, fMinTable;
+
   int fCachedB1, fCachedB2, fCachedMaxBin;
   double fCachedMax;
   bool fDrawUnderflowBin, fDrawOverflowBin;
@@ -46,6 +46,12 @@ void DisplayStack::Update() {
   fView->Update(true);
 }
 
+void DisplayStack::Update(DisplayObj *obj, bool removed) {
+  //! Let the corresponding view update the region affected by a change of obj
+
+  fView->UpdateObject(obj, removed);
+}
+
 void DisplayStack::LockUpdate() {
   //! Call LockUpdate() of corresponding view
 
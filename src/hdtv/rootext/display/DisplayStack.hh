@@ -45,6 +45,7 @@ public:
   ~DisplayStack();
 
   void Update();
+  void Update(DisplayObj *obj, bool removed = false);
 
   inline void LockUpdate();
   inline void UnlockUpdate();
@@ -35,19 +35,19 @@ MTViewer::MTViewer(UInt_t w, UInt_t h, TH2 *mat, const char *title, bool copy)
     : TGMainFrame(gClient->GetRoot(), w, h), fView(nullptr), fStatusBar(nullptr) {
   if (copy) {
     fMatCopy.reset(dynamic_cast<TH2 *>(mat->Clone()));
-    Init(w, h, fMatCopy.get(), title);
-  } else {
-    Init(w, h, mat, title);
+    mat = fMatCopy.get();
   }
+  fView = new HDTV::Display::View2D(this, w - 4, h - 4, mat);
+  Init(title);
 }
 
 MTViewer::MTViewer(UInt_t w, UInt_t h, THnSparse *mat, const char *title)
-    : TGMainFrame(gClient->GetRoot(), w, h), fView(nullptr), fStatusBar(nullptr), fMatCopy(mat->Projection(0, 1, "A")) {
-  Init(w, h, fMatCopy.get(), title);
+    : TGMainFrame(gClient->GetRoot(), w, h), fView(nullptr), fStatusBar(nullptr) {
+  fView = new HDTV::Display::View2D(this, w - 4, h - 4, mat);
+  Init(title);
 }
 
-void MTViewer::Init(UInt_t w, UInt_t h, TH2 *mat, const char *title) {
-  fView = new HDTV::Display::View2D(this, w - 4, h - 4, mat);
+void MTViewer::Init(const char *title) {
   AddFrame(fView, new TGLayoutHints(kLHintsExpandX | kLHintsExpandY, 0, 0, 0, 0));
 
   fStatusBar = new TGStatusBar(this, 10, 16);
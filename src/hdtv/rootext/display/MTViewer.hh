@@ -49,8 +49,11 @@ public:
 
   void DeleteAllCuts() { fView->DeleteAllCuts(); }
 
+  //! Memory (in bytes) the view may use for cached tiles
+  void SetTileCacheSize(std::size_t bytes) { fView->SetTileCacheSize(bytes); }
+
 private:
-  void Init(UInt_t w, UInt_t h, TH2 *mat, const char *title);
+  void Init(const char *title);
 
   HDTV::Display::View2D *fView;
   TGStatusBar *fStatusBar;
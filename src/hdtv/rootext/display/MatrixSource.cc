@@ -0,0 +1,307 @@
+/*
+ * HDTV - A ROOT-based spectrum analysis software
+ *  Copyright (C) 2006-2010  The HDTV development team (see file AUTHORS)
+ *
+ * This file is part of HDTV.
+ *
+ * HDTV is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * HDTV is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HDTV; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ */
+
+#include "MatrixSource.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <TH2.h>
+#include <THnSparse.h>
+
+namespace HDTV {
+namespace Display {
+
+namespace {
+
+//! Number of bins per dx on axis (assuming roughly equal bin widths)
+double BinsPer(const TAxis &axis, double dx) { return dx * axis.GetNbins() / (axis.GetXmax() - axis.GetXmin()); }
+
+std::vector<int> FindBins(const TAxis &axis, const double *x, int n) {
+  std::vector<int> bins(n);
+  for (int i = 0; i < n; ++i) {
+    bins[i] = axis.FindFixBin(x[i]);
+  }
+  return bins;
+}
+
+} // end anonymous namespace
+
+void MatrixPyramid::Build(int nx, int ny, const RowReader &reader) {
+  std::call_once(fBuilt, [&]() {
+    fNx = nx;
+    fNy = ny;
+
+    // Rows of the previous level (at first, the original matrix)
+    RowReader prev = reader;
+
+    std::vector<int> cols, touched;
+    std::vector<double> vals;
+    while (nx > 1 || ny > 1) {
+      Level level;
+      level.nx = (nx + 1) / 2;
+      level.ny = (ny + 1) / 2;
+      level.rowStart.reserve(level.ny + 1);
+      level.rowStart.push_back(0);
+
+      std::vector<float> max(level.nx + 1);
+      std::vector<char> used(level.nx + 1, 0);
+      for (int row = 1; row <= level.ny; ++row) {
+        // Merge the two rows of the previous level making up this row
+        for (int by = 2 * row - 1; by <= std::min(2 * row, ny); ++by) {
+          cols.clear();
+          vals.clear();
+          prev(by, cols, vals);
+          for (std::size_t i = 0; i < cols.size(); ++i) {
+            const int c = (cols[i] + 1) / 2;
+            if (!used[c]) {
+              used[c] = 1;
+              max[c] = vals[i];
+              touched.push_back(c);
+            } else {
+              max[c] = std::max(max[c], static_cast<float>(vals[i]));
+            }
+          }
+        }
+
+        std::sort(touched.begin(), touched.end());
+        for (int c : touched) {
+          level.column.push_back(c);
+          level.content.push_back(max[c]);
+          used[c] = 0;
+        }
+        touched.clear();
+        level.rowStart.push_back(level.column.size());
+      }
+
+      nx = level.nx;
+      ny = level.ny;
+      fLevels.push_back(std::move(level));
+
+      const std::size_t idx = fLevels.size() - 1;
+      prev = [this, idx](int by, std::vector<int> &c, std::vector<double> &v) {
+        const Level &l = fLevels[idx];
+        for (std::size_t j = l.rowStart[by - 1]; j < l.rowStart[by]; ++j) {
+          c.push_back(l.column[j]);
+          v.push_back(l.content[j]);
+        }
+      };
+    }
+  });
+}
+
+int MatrixPyramid::ChooseLevel(double dx, double dy) const {
+  // The largest blocks which still fit into one screen pixel
+  const double bins = std::min(dx, dy);
+  if (!(bins >= 2.0)) {
+    return 0;
+  }
+  return std::min(static_cast<int>(std::log2(bins)), GetNLevels());
+}
+
+void MatrixPyramid::GetValues(int level, const int *bx, int nx, const int *by, int ny, double *z) const {
+  const Level &l = fLevels[level - 1];
+
+  for (int j = 0; j < ny; ++j) {
+    double *row = z + j * nx;
+    if (by[j] < 1 || by[j] > fNy) {
+      std::fill(row, row + nx, 0.0);
+      continue;
+    }
+
+    const int r = ((by[j] - 1) >> level) + 1;
+    const auto first = l.column.begin() + l.rowStart[r - 1];
+    const auto last = l.column.begin() + l.rowStart[r];
+    auto it = first;
+    int prevCol = 0;
+    for (int i = 0; i < nx; ++i) {
+      if (bx[i] < 1 || bx[i] > fNx) {
+        row[i] = 0.0;
+        continue;
+      }
+      const int c = ((bx[i] - 1) >> level) + 1;
+      if (c < prevCol) {
+        it = first;
+      }
+      prevCol = c;
+      it = std::lower_bound(it, last, c);
+      row[i] = (it != last && *it == c) ? l.content[it - l.column.begin()] : 0.0;
+    }
+  }
+}
+
+void MatrixSource::GetValues(const double *x, int nx, const double *y, int ny, double *z) const {
+  for (int j = 0; j < ny; ++j) {
+    for (int i = 0; i < nx; ++i) {
+      z[j * nx + i] = GetValueAt(x[i], y[j]);
+    }
+  }
+}
+
+TH2MatrixSource::TH2MatrixSource(TH2 *hist) : fHist(hist), fMax(hist->GetMaximum()) {}
+
+double TH2MatrixSource::GetXmin() const { return fHist->GetXaxis()->GetXmin(); }
+double TH2MatrixSource::GetXmax() const { return fHist->GetXaxis()->GetXmax(); }
+double TH2MatrixSource::GetYmin() const { return fHist->GetYaxis()->GetXmin(); }
+double TH2MatrixSource::GetYmax() const { return fHist->GetYaxis()->GetXmax(); }
+
+double TH2MatrixSource::GetValueAt(double x, double y) const { return fHist->GetBinContent(fHist->FindFixBin(x, y)); }
+
+void TH2MatrixSource::GetValues(const double *x, int nx, const double *y, int ny, double *z) const {
+  // All rows share the same x bins
+  std::vector<int> bx(nx);
+  for (int i = 0; i < nx; ++i) {
+    bx[i] = fHist->GetXaxis()->FindFixBin(x[i]);
+  }
+
+  for (int j = 0; j < ny; ++j) {
+    const int by = fHist->GetYaxis()->FindFixBin(y[j]);
+    for (int i = 0; i < nx; ++i) {
+      z[j * nx + i] = fHist->GetBinContent(bx[i], by);
+    }
+  }
+}
+
+void TH2MatrixSource::GetMaxValues(const double *x, int nx, const double *y, int ny, double dx, double dy,
+                                   double *z) const {
+  const TAxis &xAxis = *fHist->GetXaxis();
+  const TAxis &yAxis = *fHist->GetYaxis();
+  const double binsX = BinsPer(xAxis, dx);
+  const double binsY = BinsPer(yAxis, dy);
+
+  if (std::min(binsX, binsY) < 2.0) {
+    GetValues(x, nx, y, ny, z);
+    return;
+  }
+
+  fPyramid.Build(xAxis.GetNbins(), yAxis.GetNbins(), [this](int by, std::vector<int> &cols, std::vector<double> &vals) {
+    for (int bx = 1; bx <= fHist->GetNbinsX(); ++bx) {
+      const double v = fHist->GetBinContent(bx, by);
+      if (v != 0.0) {
+        cols.push_back(bx);
+        vals.push_back(v);
+      }
+    }
+  });
+
+  const int level = fPyramid.ChooseLevel(binsX, binsY);
+  if (level == 0) {
+    GetValues(x, nx, y, ny, z);
+    return;
+  }
+  fPyramid.GetValues(level, FindBins(xAxis, x, nx).data(), nx, FindBins(yAxis, y, ny).data(), ny, z);
+}
+
+SparseMatrixSource::SparseMatrixSource(THnSparse *hist)
+    : fXAxis(*hist->GetAxis(0)), fYAxis(*hist->GetAxis(1)), fMax(0.0) {
+  const int nx = fXAxis.GetNbins();
+  const int ny = fYAxis.GetNbins();
+  fRows.Build(ny, [&](auto add) {
+    Int_t coord[2];
+    for (Long64_t i = 0; i < hist->GetNbins(); ++i) {
+      double z = hist->GetBinContent(i, coord);
+      if (z != 0.0 && coord[0] >= 1 && coord[0] <= nx && coord[1] >= 1 && coord[1] <= ny) {
+        add(coord[1], coord[0], z);
+      }
+    }
+  });
+
+  const auto &contents = fRows.GetContents();
+  if (!contents.empty()) {
+    fMax = std::max(0.0, *std::max_element(contents.begin(), contents.end()));
+  }
+}
+
+double SparseMatrixSource::GetValueAt(double x, double y) const {
+  const int bx = fXAxis.FindFixBin(x);
+  const int by = fYAxis.FindFixBin(y);
+  if (bx < 1 || bx > fXAxis.GetNbins() || by < 1 || by > fYAxis.GetNbins()) {
+    return 0.0;
+  }
+
+  const auto &columns = fRows.GetColumns();
+  auto first = columns.begin() + fRows.GetRowBegin(by);
+  auto last = columns.begin() + fRows.GetRowEnd(by);
+  auto it = std::lower_bound(first, last, bx);
+  if (it == last || *it != bx) {
+    return 0.0;
+  }
+  return fRows.GetContents()[it - columns.begin()];
+}
+
+void SparseMatrixSource::GetValues(const double *x, int nx, const double *y, int ny, double *z) const {
+  std::vector<int> bx(nx);
+  for (int i = 0; i < nx; ++i) {
+    bx[i] = fXAxis.FindFixBin(x[i]);
+  }
+
+  for (int j = 0; j < ny; ++j) {
+    double *row = z + j * nx;
+    const int by = fYAxis.FindFixBin(y[j]);
+    if (by < 1 || by > fYAxis.GetNbins()) {
+      std::fill(row, row + nx, 0.0);
+      continue;
+    }
+
+    // For increasing x, continue the search where the previous one stopped
+    const auto &columns = fRows.GetColumns();
+    const auto first = columns.begin() + fRows.GetRowBegin(by);
+    const auto last = columns.begin() + fRows.GetRowEnd(by);
+    auto it = first;
+    for (int i = 0; i < nx; ++i) {
+      if (i > 0 && bx[i] < bx[i - 1]) {
+        it = first;
+      }
+      it = std::lower_bound(it, last, bx[i]);
+      row[i] = (it != last && *it == bx[i]) ? fRows.GetContents()[it - columns.begin()] : 0.0;
+    }
+  }
+}
+
+void SparseMatrixSource::GetMaxValues(const double *x, int nx, const double *y, int ny, double dx, double dy,
+                                      double *z) const {
+  const double binsX = BinsPer(fXAxis, dx);
+  const double binsY = BinsPer(fYAxis, dy);
+
+  if (std::min(binsX, binsY) < 2.0) {
+    GetValues(x, nx, y, ny, z);
+    return;
+  }
+
+  fPyramid.Build(fXAxis.GetNbins(), fYAxis.GetNbins(), [this](int by, std::vector<int> &cols, std::vector<double> &vals) {
+    const auto &columns = fRows.GetColumns();
+    const auto &contents = fRows.GetContents();
+    cols.insert(cols.end(), columns.begin() + fRows.GetRowBegin(by), columns.begin() + fRows.GetRowEnd(by));
+    vals.insert(vals.end(), contents.begin() + fRows.GetRowBegin(by), contents.begin() + fRows.GetRowEnd(by));
+  });
+
+  const int level = fPyramid.ChooseLevel(binsX, binsY);
+  if (level == 0) {
+    GetValues(x, nx, y, ny, z);
+    return;
+  }
+  fPyramid.GetValues(level, FindBins(fXAxis, x, nx).data(), nx, FindBins(fYAxis, y, ny).data(), ny, z);
+}
+
+} // end namespace Display
+} // end namespace HDTV
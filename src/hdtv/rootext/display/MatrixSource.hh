@@ -0,0 +1,162 @@
+/*
+ * HDTV - A ROOT-based spectrum analysis software
+ *  Copyright (C) 2006-2010  The HDTV development team (see file AUTHORS)
+ *
+ * This file is part of HDTV.
+ *
+ * HDTV is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * HDTV is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HDTV; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ */
+
+#ifndef __MatrixSource_h__
+#define __MatrixSource_h__
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <TAxis.h>
+
+#include "SparseRows.hh"
+
+class TH2;
+class THnSparse;
+
+namespace HDTV {
+namespace Display {
+
+//! Max-reduced copies of a matrix at decreasing resolution, for zoomed-out display
+/*!
+ * Level k (k >= 1) holds, for each block of 2^k x 2^k bins of the original
+ * matrix, the largest content in that block. Like SparseMatrixSource, levels
+ * are stored as compressed sparse rows, so empty regions take no memory.
+ */
+class MatrixPyramid {
+public:
+  //! Fills cols and vals with the (1-based) columns and contents of the non-empty bins in row by
+  using RowReader = std::function<void(int by, std::vector<int> &cols, std::vector<double> &vals)>;
+
+  //! Build all levels of an nx x ny matrix from its rows. Only the first call
+  //! does anything; it is safe to call from several threads at once.
+  void Build(int nx, int ny, const RowReader &reader);
+
+  int GetNLevels() const { return fLevels.size(); }
+
+  //! Contents at the given level (1 ... GetNLevels()) of the blocks containing
+  //! the original bins (bx[i], by[j]), stored in z[j * nx + i]
+  void GetValues(int level, const int *bx, int nx, const int *by, int ny, double *z) const;
+
+  //! Level to use when a screen pixel covers dx x dy bins
+  int ChooseLevel(double dx, double dy) const;
+
+private:
+  struct Level {
+    int nx, ny;
+    std::vector<std::size_t> rowStart;
+    std::vector<int> column;
+    std::vector<float> content;
+  };
+
+  std::once_flag fBuilt;
+  int fNx = 0, fNy = 0;
+  std::vector<Level> fLevels;
+};
+
+//! Read-only access to the contents of a matrix, as needed by View2D
+/*!
+ * All const member functions must be safe to call from several threads at
+ * once, as View2D renders tiles in parallel.
+ */
+class MatrixSource {
+public:
+  virtual ~MatrixSource() = default;
+
+  virtual double GetXmin() const = 0;
+  virtual double GetXmax() const = 0;
+  virtual double GetYmin() const = 0;
+  virtual double GetYmax() const = 0;
+  virtual double GetMaximum() const = 0;
+
+  //! Content of the bin containing (x, y), or zero outside of the matrix
+  virtual double GetValueAt(double x, double y) const = 0;
+
+  //! Contents at the grid points (x[i], y[j]), stored row by row in z[j * nx + i]
+  virtual void GetValues(const double *x, int nx, const double *y, int ny, double *z) const;
+
+  //! Like GetValues(), for a grid with a spacing of dx and dy. If a grid cell
+  //! spans several bins, each value is the maximum of a block of bins around
+  //! the grid point, so that peaks stay visible when zoomed out.
+  virtual void GetMaxValues(const double *x, int nx, const double *y, int ny, double dx, double dy,
+                            double *z) const {
+    GetValues(x, nx, y, ny, z);
+  }
+};
+
+//! MatrixSource backed by a (dense) ROOT TH2
+class TH2MatrixSource : public MatrixSource {
+public:
+  explicit TH2MatrixSource(TH2 *hist);
+
+  double GetXmin() const override;
+  double GetXmax() const override;
+  double GetYmin() const override;
+  double GetYmax() const override;
+  double GetMaximum() const override { return fMax; }
+  double GetValueAt(double x, double y) const override;
+  void GetValues(const double *x, int nx, const double *y, int ny, double *z) const override;
+  void GetMaxValues(const double *x, int nx, const double *y, int ny, double dx, double dy,
+                    double *z) const override;
+
+private:
+  TH2 *fHist;
+  double fMax;
+
+  mutable MatrixPyramid fPyramid;
+};
+
+//! MatrixSource for a two-dimensional THnSparse
+/*!
+ * The filled bins are copied into a compressed sparse row structure, with
+ * the columns of each row sorted, so that lookups are a binary search
+ * within a single row. No dense projection of the matrix is ever created.
+ */
+class SparseMatrixSource : public MatrixSource {
+public:
+  explicit SparseMatrixSource(THnSparse *hist);
+
+  double GetXmin() const override { return fXAxis.GetXmin(); }
+  double GetXmax() const override { return fXAxis.GetXmax(); }
+  double GetYmin() const override { return fYAxis.GetXmin(); }
+  double GetYmax() const override { return fYAxis.GetXmax(); }
+  double GetMaximum() const override { return fMax; }
+  double GetValueAt(double x, double y) const override;
+  void GetValues(const double *x, int nx, const double *y, int ny, double *z) const override;
+  void GetMaxValues(const double *x, int nx, const double *y, int ny, double dx, double dy,
+                    double *z) const override;
+
+private:
+  TAxis fXAxis, fYAxis;
+  double fMax;
+
+  mutable MatrixPyramid fPyramid;
+
+  SparseRows fRows; // rows are the y bins
+};
+
+} // end namespace Display
+} // end namespace HDTV
+
+#endif
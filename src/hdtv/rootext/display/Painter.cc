@@ -22,6 +22,10 @@
 
 #include "Painter.hh"
 
+#include <algorithm>
+
+#include <X11/Xlib.h>
+
 #include <TGX11.h>
 
 #include "DisplayFunc.hh"
@@ -53,12 +57,18 @@ void Painter::DrawFunction(DisplayFunc *dFunc, int x1, int x2) {
   x1 = std::max(x1, EtoX(dFunc->GetMinE()));
   x2 = std::min(x2, EtoX(dFunc->GetMaxE()));
 
+  if (x2 < x1) {
+    return;
+  }
+
+  const PixelEdges &edges = GetPixelEdges(dFunc->fCal, x1, x2);
+
   int ly, cy;
-  ch = dFunc->E2Ch(XtoE(x1 - 0.5));
+  ch = edges[x1];
   ly = CtoY(norm * dFunc->Eval(ch));
 
   for (x = x1; x <= x2; x++) {
-    ch = dFunc->E2Ch(XtoE(x + 0.5));
+    ch = edges[x + 1];
     y = cy = CtoY(norm * dFunc->Eval(ch));
 
     if (std::min(y, ly) <= lClip && std::max(y, ly) >= hClip) {
@@ -74,11 +84,13 @@ void Painter::DrawFunction(DisplayFunc *dFunc, int x1, int x2) {
         ly = lClip;
       }
 
-      gVirtualX->DrawLine(fDrawable, dFunc->GetGC()->GetGC(), x, ly, x, cy);
+      AddSegment(x, ly, x, cy);
     }
 
     ly = y;
   }
+
+  FlushSegments(dFunc->GetGC()->GetGC());
 }
 
 void Painter::DrawSpectrum(DisplaySpec *dSpec, int x1, int x2) {
@@ -93,35 +105,41 @@ void Painter::DrawSpectrum(DisplaySpec *dSpec, int x1, int x2) {
   x1 = std::max(x1, EtoX(dSpec->GetMinE()));
   x2 = std::min(x2, EtoX(dSpec->GetMaxE()));
 
+  if (x2 < x1) {
+    return;
+  }
+
+  const PixelEdges &edges = GetPixelEdges(dSpec->fCal, x1 - 1, x2);
+
   switch (fViewMode) {
   case kVMSolid:
     for (x = x1; x <= x2; x++) {
-      y = GetYAtPixel(dSpec, x);
+      y = GetYAtPixel(dSpec, edges, x);
       if (y < hClip) {
         y = hClip;
       }
       if (y > lClip) {
         y = lClip;
       }
-      gVirtualX->DrawLine(fDrawable, dSpec->GetGC()->GetGC(), x, fYBase, x, y);
+      AddSegment(x, fYBase, x, y);
     }
     break;
 
   case kVMDotted:
     for (x = x1; x <= x2; x++) {
-      y = GetYAtPixel(dSpec, x);
+      y = GetYAtPixel(dSpec, edges, x);
       if (y >= hClip && y <= lClip) {
-        gVirtualX->DrawRectangle(fDrawable, dSpec->GetGC()->GetGC(), x, y, 0, 0);
+        AddPoint(x, y);
       }
     }
     break;
 
   case kVMHollow:
     int ly, y1, y2;
-    ly = GetYAtPixel(dSpec, x1 - 1);
+    ly = GetYAtPixel(dSpec, edges, x1 - 1);
 
     for (x = x1; x <= x2; x++) {
-      y = GetYAtPixel(dSpec, x);
+      y = GetYAtPixel(dSpec, edges, x);
 
       if (y < ly) {
         if (ly >= hClip && y <= lClip) {
@@ -133,7 +151,7 @@ void Painter::DrawSpectrum(DisplaySpec *dSpec, int x1, int x2) {
           if (y2 < hClip) {
             y2 = hClip;
           }
-          gVirtualX->DrawLine(fDrawable, dSpec->GetGC()->GetGC(), x, y1, x, y2);
+          AddSegment(x, y1, x, y2);
         }
       } else {
         if (y >= hClip && ly <= lClip) {
@@ -146,10 +164,10 @@ void Painter::DrawSpectrum(DisplaySpec *dSpec, int x1, int x2) {
             y2 = lClip;
           }
           if (x > fXBase) {
-            gVirtualX->DrawLine(fDrawable, dSpec->GetGC()->GetGC(), x - 1, y1, x - 1, y2);
+            AddSegment(x - 1, y1, x - 1, y2);
           }
           if (y <= lClip) {
-            gVirtualX->DrawRectangle(fDrawable, dSpec->GetGC()->GetGC(), x, y2, 0, 0);
+            AddPoint(x, y2);
           }
         }
       }
@@ -158,6 +176,29 @@ void Painter::DrawSpectrum(DisplaySpec *dSpec, int x1, int x2) {
     }
     break;
   }
+
+  FlushSegments(dSpec->GetGC()->GetGC());
+  FlushPoints(dSpec->GetGC()->GetGC());
+}
+
+void Painter::FlushSegments(GContext_t gc) {
+  //! Draw all segments collected with AddSegment() in one request
+
+  if (!fSegments.empty()) {
+    XDrawSegments(reinterpret_cast<::Display *>(gVirtualX->GetDisplay()), static_cast<Drawable>(fDrawable),
+                  reinterpret_cast<GC>(gc), reinterpret_cast<XSegment *>(fSegments.data()), fSegments.size());
+    fSegments.clear();
+  }
+}
+
+void Painter::FlushPoints(GContext_t gc) {
+  //! Draw all points collected with AddPoint() in one request
+
+  if (!fPoints.empty()) {
+    XDrawPoints(reinterpret_cast<::Display *>(gVirtualX->GetDisplay()), static_cast<Drawable>(fDrawable),
+                reinterpret_cast<GC>(gc), reinterpret_cast<XPoint *>(fPoints.data()), fPoints.size(), CoordModeOrigin);
+    fPoints.clear();
+  }
 }
 
 void Painter::DrawXMarker(XMarker *marker, int x1, int x2) {
@@ -272,22 +313,89 @@ void Painter::SetSize(int w, int h) {
   UpdateYZoom();
 }
 
-int Painter::GetYAtPixel(DisplaySpec *dSpec, Int_t x) {
+const Painter::PixelEdges &Painter::GetPixelEdges(const Calibration &cal, int x1, int x2) {
+  //! Get the table of pixel column edges for calibration cal, making sure it
+  //! covers the columns x1 to x2 (inclusive)
+
+  const unsigned int cMaxCachedCals = 8;
+
+  auto edges = std::find_if(fPixelEdges.begin(), fPixelEdges.end(),
+                            [&cal](const PixelEdges &e) { return e.fCal == cal; });
+  if (edges == fPixelEdges.end()) {
+    if (fPixelEdges.size() >= cMaxCachedCals) {
+      fPixelEdges.pop_back();
+    }
+    fPixelEdges.push_front(PixelEdges{cal, 0.0, 0.0, 0, 0, {}});
+  } else {
+    fPixelEdges.splice(fPixelEdges.begin(), fPixelEdges, edges);
+  }
+  PixelEdges &e = fPixelEdges.front();
+
+  // The table can be reused if the offset moved by a whole number of pixels
+  double shift = (fXOffset - e.fXOffset) * fXZoom;
+  if (e.fCh.empty() || e.fXZoom != fXZoom || std::abs(std::ceil(shift - 0.5) - shift) > 1e-7) {
+    e.fXZoom = fXZoom;
+    e.fXOffset = fXOffset;
+    e.fCh.clear();
+    shift = 0.0;
+  }
+
+  // Columns of the table, relative to e.fXOffset
+  int s = std::ceil(shift - 0.5);
+  int u1 = x1 - fXBase + s;
+  int u2 = x2 + 1 - fXBase + s;
+  auto edgeCh = [&e](int from, int to, double *ch) {
+    for (int u = from; u <= to; u++) {
+      ch[u - from] = (u - 0.5) / e.fXZoom + e.fXOffset;
+    }
+    e.fCal.E2Ch(ch, ch, to - from + 1);
+  };
+
+  // Do not let the table grow without bounds while scrolling
+  if (!e.fCh.empty()) {
+    int first = std::min(u1, e.fFirst);
+    int last = std::max(u2, e.fFirst + static_cast<int>(e.fCh.size()) - 1);
+    if (last - first > 16 * std::max(fWidth, u2 - u1)) {
+      e.fCh.clear();
+    }
+  }
+
+  if (e.fCh.empty()) {
+    e.fFirst = u1;
+    e.fCh.resize(u2 - u1 + 1);
+    edgeCh(u1, u2, e.fCh.data());
+  } else {
+    if (u1 < e.fFirst) {
+      e.fCh.insert(e.fCh.begin(), e.fFirst - u1, 0.0);
+      edgeCh(u1, e.fFirst - 1, e.fCh.data());
+      e.fFirst = u1;
+    }
+    int last = e.fFirst + e.fCh.size() - 1;
+    if (u2 > last) {
+      e.fCh.resize(u2 - e.fFirst + 1);
+      edgeCh(last + 1, u2, e.fCh.data() + (last + 1 - e.fFirst));
+    }
+  }
+
+  e.fIndex = s - fXBase - e.fFirst;
+  return e;
+}
+
+int Painter::GetYAtPixel(DisplaySpec *dSpec, const PixelEdges &edges, Int_t x) {
   if (fUseNorm) {
-    return CtoY(dSpec->GetNorm() * GetCountsAtPixel(dSpec, x));
+    return CtoY(dSpec->GetNorm() * GetCountsAtPixel(dSpec, edges, x));
   } else {
-    return CtoY(GetCountsAtPixel(dSpec, x));
+    return CtoY(GetCountsAtPixel(dSpec, edges, x));
   }
 }
 
-double Painter::GetCountsAtPixel(DisplaySpec *dSpec, Int_t x) {
+double Painter::GetCountsAtPixel(DisplaySpec *dSpec, const PixelEdges &edges, Int_t x) {
   //! Get counts at screen X position x
-  // FIXME: this could be significantly optimized...
 
-  // Calculate the lower and upper edge of the screen bin in fractional
-  // histogram channels, applying the calibration if specified
-  double c1 = dSpec->E2Ch(XtoE(x - 0.5));
-  double c2 = dSpec->E2Ch(XtoE(x + 0.5));
+  // Lower and upper edge of the screen bin in fractional histogram channels,
+  // with the calibration applied
+  double c1 = edges[x];
+  double c2 = edges[x + 1];
 
   // Our calibration may have a negative slope...
   if (c1 > c2) {
@@ -481,21 +589,36 @@ void Painter::DrawXNonlinearScale(Int_t x1, Int_t x2, bool top, const Calibratio
   // if(n < 0)
   //  fmt[2] = '0' - n;
 
+  // Channels at the ends of the scale
+  double range[2] = {XtoE(x1), XtoE(x2)};
+  cal.E2Ch(range, range, 2);
+
+  // Energies of the tics, in multiples of tic
+  std::vector<double> ticChannels, tics;
+  auto ticEnergies = [&](double tic) {
+    i = std::ceil(range[0] / tic);
+    i2 = std::floor(range[1] / tic);
+    ticChannels.resize(std::max(i2 - i + 1, 0));
+    for (size_t k = 0; k < ticChannels.size(); ++k) {
+      ticChannels[k] = (i + static_cast<int>(k)) * tic;
+    }
+    tics = cal.Ch2E(ticChannels);
+  };
+
   // Draw the minor tics
-  i = std::ceil(cal.E2Ch(XtoE(x1)) / minor_tic);
-  i2 = std::floor(cal.E2Ch(XtoE(x2)) / minor_tic);
+  ticEnergies(minor_tic);
 
-  for (; i <= i2; ++i) {
-    x = EtoX(cal.Ch2E(i * minor_tic));
-    gVirtualX->DrawLine(fDrawable, fAxisGC, x, y, x, y + 5 * sgn);
+  for (double e : tics) {
+    x = EtoX(e);
+    AddSegment(x, y, x, y + 5 * sgn);
   }
+  FlushSegments(fAxisGC);
 
   // Draw the major tics
-  i = std::ceil(cal.E2Ch(XtoE(x1)) / major_tic);
-  i2 = std::floor(cal.E2Ch(XtoE(x2)) / major_tic);
+  ticEnergies(major_tic);
 
-  for (; i <= i2; ++i) {
-    x = EtoX(cal.Ch2E(i * major_tic));
+  for (size_t k = 0; k < tics.size(); ++k, ++i) {
+    x = EtoX(tics[k]);
     gVirtualX->DrawLine(fDrawable, fAxisGC, x, y, x, y + 9 * sgn);
 
     // TODO: handle len > 16
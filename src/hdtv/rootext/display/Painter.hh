@@ -36,6 +36,7 @@
 #include <cmath>
 
 #include <list>
+#include <vector>
 
 #include <TGFont.h>
 #include <TGFrame.h>
@@ -114,6 +115,7 @@ public:
   Int_t GetWidth() { return fWidth; }
   Int_t GetHeight() { return fHeight; }
   void SetDrawable(Drawable_t drawable) { fDrawable = drawable; }
+  FontStruct_t GetFontStruct() const { return fFontStruct; }
   void SetAxisGC(GContext_t gc) { fAxisGC = gc; }
   void SetClearGC(GContext_t gc) { fClearGC = gc; }
   void SetXOffset(double offset) { fXOffset = offset; }
@@ -169,12 +171,34 @@ protected:
   void DrawYMajorTic(double c, bool drawLine = true);
   void DrawString(GContext_t gc, int x, int y, const char *str, size_t len, HTextAlign hAlign, VTextAlign vAlign);
   inline void DrawYMinorTic(double c);
-  double GetCountsAtPixel(DisplaySpec *dSpec, Int_t x);
-  int GetYAtPixel(DisplaySpec *dSpec, Int_t x);
+
+  //! Channels of the edges of the pixel columns for one calibration. As long
+  //! as the zoom stays the same and the offset only changes by whole pixels
+  //! (i.e. while scrolling), the table is reused and only extended.
+  struct PixelEdges {
+    Calibration fCal;
+    double fXZoom;
+    double fXOffset;         // offset at which the table was started
+    int fFirst;              // column of fCh[0], relative to fXOffset
+    int fIndex;              // index of column 0 for the current base point and offset
+    std::vector<double> fCh; // channel at the left edge of each column
+
+    //! Channel at the left edge of screen column x
+    double operator[](int x) const { return fCh[x + fIndex]; }
+  };
+
+  const PixelEdges &GetPixelEdges(const Calibration &cal, int x1, int x2);
+  double GetCountsAtPixel(DisplaySpec *dSpec, const PixelEdges &edges, Int_t x);
+  int GetYAtPixel(DisplaySpec *dSpec, const PixelEdges &edges, Int_t x);
 
   void GetTicDistance(double tic, double &major_tic, double &minor_tic, int &n);
   void UpdateYZoom();
 
+  inline void AddSegment(int x1, int y1, int x2, int y2);
+  inline void AddPoint(int x, int y);
+  void FlushSegments(GContext_t gc);
+  void FlushPoints(GContext_t gc);
+
 protected:
   Int_t fWidth, fHeight;
   Int_t fXBase, fYBase;
@@ -189,8 +213,23 @@ protected:
   GContext_t fClearGC;
   const TGFont *fFont;
   FontStruct_t fFontStruct;
+
+  // Segments and points collected while drawing an object, sent to the X
+  // server in a single request each
+  std::vector<Segment_t> fSegments;
+  std::vector<Point_t> fPoints;
+
+  // Pixel edge tables of the most recently used calibrations, most recent first
+  std::list<PixelEdges> fPixelEdges;
 };
 
+void Painter::AddSegment(int x1, int y1, int x2, int y2) {
+  fSegments.push_back({static_cast<Short_t>(x1), static_cast<Short_t>(y1), static_cast<Short_t>(x2),
+                       static_cast<Short_t>(y2)});
+}
+
+void Painter::AddPoint(int x, int y) { fPoints.push_back({static_cast<Short_t>(x), static_cast<Short_t>(y)}); }
+
 } // end namespace Display
 } // end namespace HDTV
 
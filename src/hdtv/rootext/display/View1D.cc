@@ -24,6 +24,7 @@
 
 #include <cmath>
 
+#include <algorithm>
 #include <iostream>
 #include <limits>
 
@@ -82,6 +83,7 @@ View1D::View1D(const TGWindow *p, UInt_t w, UInt_t h) : View(p, w, h), fCurrentC
   fUpdateLocked = 0;
   fNeedsUpdate = false;
   fForceRedraw = false;
+  fDirty = false;
 
   SetDarkMode();
 }
@@ -332,6 +334,78 @@ void View1D::Update(bool forceRedraw) {
   }
 }
 
+void View1D::UpdateObject(DisplayObj *obj, bool removed) {
+  //! Update the view after a change of obj. If the object reports the region
+  //! it paints in, only the region it occupied before and the one it occupies
+  //! now are repainted.
+
+  bool full = false;
+
+  auto markDirty = [this, &full](const ERange &range) {
+    if (!range.valid) {
+      full = true;
+    } else if (!fDirty) {
+      fDirtyRange = range;
+      fDirty = true;
+    } else {
+      fDirtyRange.e1 = std::min(fDirtyRange.e1, range.e1);
+      fDirtyRange.e2 = std::max(fDirtyRange.e2, range.e2);
+      fDirtyRange.margin = std::max(fDirtyRange.margin, range.margin);
+    }
+  };
+
+  auto old = fObjRanges.find(obj);
+  if (old != fObjRanges.end()) {
+    markDirty(old->second);
+  }
+
+  if (removed) {
+    if (old != fObjRanges.end()) {
+      fObjRanges.erase(old);
+    }
+  } else {
+    ERange range{};
+    range.valid = obj->GetERange(fPainter, range.e1, range.e2, range.margin);
+    markDirty(range);
+    fObjRanges[obj] = range;
+  }
+
+  Update(full);
+}
+
+void View1D::RedrawRegion(int x1, int x2) {
+  //! Clear and repaint the pixel columns x1 to x2 (inclusive) of the plot area
+
+  Bool_t cv = fCursorVisible;
+  int x, y, w, h;
+
+  x = fLeftBorder + 2;
+  y = fTopBorder + 2;
+  w = fWidth - fLeftBorder - fRightBorder - 4;
+  h = fHeight - fTopBorder - fBottomBorder - 4;
+
+  x1 = std::max(x1, x);
+  x2 = std::min(x2, x + w);
+  if (x2 < x1) {
+    return;
+  }
+
+  if (cv) {
+    DrawCursor();
+  }
+
+  if (fDarkMode) {
+    gVirtualX->FillRectangle(GetId(), GetBlackGC()(), x1, y, x2 - x1 + 1, h + 1);
+  } else {
+    gVirtualX->FillRectangle(GetId(), GetWhiteGC()(), x1, y, x2 - x1 + 1, h + 1);
+  }
+  fDisplayStack.PaintRegion(x1, x2, fPainter);
+
+  if (cv) {
+    DrawCursor();
+  }
+}
+
 void View1D::DoUpdate() {
   //! This function brings the viewport up-to-date after a change in any
   //! relevant parameters. It tries to do so with minimal effort,
@@ -381,9 +455,22 @@ void View1D::DoUpdate() {
     // cout << "redraw" << endl;
     fNeedClear = true;
     gClient->NeedRedraw(this);
-  } else if (std::abs(dOPix) > 0.5) {
-    ShiftOffset(std::ceil(dOPix - 0.5));
+  } else {
+    if (std::abs(dOPix) > 0.5) {
+      ShiftOffset(std::ceil(dOPix - 0.5));
+    }
+
+    // Repaint what changed since the last update
+    if (fDirty) {
+      // Limit the energies to (well beyond) the screen before converting them to pixels
+      const double eMin = fPainter.XtoE(-static_cast<Int_t>(fWidth));
+      const double eMax = fPainter.XtoE(2 * static_cast<Int_t>(fWidth));
+      const double e1 = std::min(std::max(fDirtyRange.e1, eMin), eMax);
+      const double e2 = std::min(std::max(fDirtyRange.e2, eMin), eMax);
+      RedrawRegion(fPainter.EtoX(e1) - 1, fPainter.EtoX(e2) + fDirtyRange.margin + 1);
+    }
   }
+  fDirty = false;
 
   UpdateScrollbarRange();
   UpdateStatusPos();
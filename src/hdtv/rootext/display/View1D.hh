@@ -24,6 +24,7 @@
 #define __View1D_h__
 
 #include <list>
+#include <map>
 
 #include "Calibration.hpp"
 #include "DisplayStack.hh"
@@ -121,6 +122,7 @@ public:
   void LockUpdate();
   void UnlockUpdate();
   void Update(bool forceRedraw = false);
+  void UpdateObject(DisplayObj *obj, bool removed = false);
 
   /*** Helper functions to draw scales ***/
   void DrawXScales(UInt_t x1, UInt_t x2);
@@ -138,6 +140,7 @@ protected:
   Bool_t HandleButton(Event_t *ev) override;
   Bool_t HandleCrossing(Event_t *ev) override;
   void ShiftOffset(int dO);
+  void RedrawRegion(int x1, int x2);
 
   void UpdateStatusPos();
   void UpdateStatusScale();
@@ -150,6 +153,21 @@ protected:
   bool fDarkMode;
 
   Calibration fCurrentCal;
+
+  //! Region painted by a display object (see DisplayObj::GetERange())
+  struct ERange {
+    bool valid;
+    double e1, e2;
+    int margin;
+  };
+
+  // Regions of the objects as last painted (declared before fDisplayStack,
+  // as its destructor removes the objects from the view)
+  std::map<const DisplayObj *, ERange> fObjRanges; //!
+  // Region that needs repainting at the next update, if fDirty
+  bool fDirty;
+  ERange fDirtyRange;
+
   DisplayStack fDisplayStack;
 
   Bool_t fYAutoScale;
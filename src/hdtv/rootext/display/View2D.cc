@@ -22,21 +22,108 @@
 
 #include "View2D.hh"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include <KeySymbols.h>
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
 
 #include <TGStatusBar.h>
 #include <TH2.h>
+#include <THnSparse.h>
 
 namespace HDTV {
 namespace Display {
 
+namespace {
+
+//! Masks and shifts needed to compose an XImage pixel from 8 bit color channels
+struct PixelFormat {
+  explicit PixelFormat(const XImage *img);
+
+  unsigned long Pixel(int r, int g, int b) const {
+    r = (r_shift > 0) ? (r << r_shift) : (r >> (-r_shift));
+    g = (g_shift > 0) ? (g << g_shift) : (g >> (-g_shift));
+    b = (b_shift > 0) ? (b << b_shift) : (b >> (-b_shift));
+    return (r & r_mask) | (g & g_mask) | (b & b_mask);
+  }
+
+  unsigned long r_mask, g_mask, b_mask;
+  int r_shift, g_shift, b_shift;
+};
+
+PixelFormat::PixelFormat(const XImage *img) {
+  /* Calculate shifts required for color channels. Positive shifts go to the
+     left, negative shifts go to the right.
+
+     NOTE: This code only works as long as the bit mask for each color channel
+     contains only a single, continuous strings of 1s. Otherwise, much more
+     complicated and slow code would be needed, as a single shift would no
+     longer be sufficient.   */
+  r_mask = img->red_mask;
+  g_mask = img->green_mask;
+  b_mask = img->blue_mask;
+
+  r_shift = g_shift = b_shift = 0;
+  while (r_mask) {
+    r_mask >>= 1;
+    r_shift++;
+  }
+  r_shift -= 8;
+  while (g_mask) {
+    g_mask >>= 1;
+    g_shift++;
+  }
+  g_shift -= 8;
+  while (b_mask) {
+    b_mask >>= 1;
+    b_shift++;
+  }
+  b_shift -= 8;
+
+  r_mask = img->red_mask;
+  g_mask = img->green_mask;
+  b_mask = img->blue_mask;
+}
+
+//! True if 32 bit pixels can be stored directly into the image data
+bool HasNative32BitPixels(const XImage *img) {
+  const uint32_t one = 1;
+  const int hostOrder = (*reinterpret_cast<const unsigned char *>(&one) == 1) ? LSBFirst : MSBFirst;
+  return img->bits_per_pixel == 32 && img->byte_order == hostOrder;
+}
+
+} // end anonymous namespace
+
+//! Tiles rendered ahead of time. fThread fills the images in order and counts
+//! the finished ones in fFilled; everything else is only touched by the GUI
+//! thread.
+struct View2D::PrefetchJob {
+  std::vector<std::pair<int, int>> fTiles;
+  std::vector<TileKey> fKeys;
+  std::vector<Drawable_t> fImages;
+  std::atomic<std::size_t> fFilled{0};
+  std::atomic<bool> fCancel{false};
+  std::size_t fUploaded = 0;
+  std::thread fThread;
+};
+
 View2D::View2D(const TGWindow *p, UInt_t w, UInt_t h, TH2 *mat)
-    : View(p, w, h), fXEOffset{0.0}, fYEOffset{0.0}, fXTileOffset{0}, fYTileOffset{0}, fVPHeight{0}, fVPWidth{0} {
-  fMatrix = mat;
-  fMatrixMax = fMatrix->GetMaximum();
+    : View2D(p, w, h, std::make_unique<TH2MatrixSource>(mat)) {}
+
+//! Display a two-dimensional THnSparse, without converting it to a dense TH2
+View2D::View2D(const TGWindow *p, UInt_t w, UInt_t h, THnSparse *mat)
+    : View2D(p, w, h, std::make_unique<SparseMatrixSource>(mat)) {}
+
+View2D::View2D(const TGWindow *p, UInt_t w, UInt_t h, std::unique_ptr<MatrixSource> source)
+    : View(p, w, h), fTileCacheSize{64 << 20}, fVisibleTiles{0}, fPrefetchTimer{std::make_unique<TTimer>(this, 0)},
+      fPrefetchPending{false}, fPrefetchQueued{false}, fPanX{0}, fPanY{0}, fSource{std::move(source)}, fXEOffset{0.0}, fYEOffset{0.0},
+      fXTileOffset{0}, fYTileOffset{0}, fVPHeight{0}, fVPWidth{0} {
+  fMatrixMax = fSource->GetMaximum();
 
   fStatusBar = nullptr;
 
@@ -75,9 +162,148 @@ void View2D::ShiftOffset(int dX, int dY) {
   fXTileOffset += dX;
   fYTileOffset += dY;
 
+  fPanX = (dX > 0) - (dX < 0);
+  fPanY = (dY > 0) - (dY < 0);
+  fPrefetchQueued = true;
+  SchedulePrefetch();
+
   gClient->NeedRedraw(this);
 }
 
+Bool_t View2D::HandleTimer(TTimer *timer) {
+  if (timer != fPrefetchTimer.get()) {
+    return View::HandleTimer(timer);
+  }
+
+  fPrefetchPending = false;
+  if (fPrefetch) {
+    UploadPrefetched();
+  }
+  // If the view moved while a job was running, continue from the new position
+  if (!fPrefetch && fPrefetchQueued) {
+    StartPrefetch();
+  }
+  if (fPrefetch) {
+    SchedulePrefetch();
+  }
+  return true;
+}
+
+void View2D::SchedulePrefetch() {
+  if (!fPrefetchPending) {
+    fPrefetchPending = true;
+    fPrefetchTimer->Start(cPrefetchDelay, kTRUE);
+  }
+}
+
+//! Start rendering the tiles just outside of the screen that will become
+//! visible next if the view keeps moving in the direction of the last shift
+//! (or all around the screen after a zoom). The pan direction is consumed.
+void View2D::StartPrefetch() {
+  int x1 = GetTileId(fLeftBorder - fXTileOffset);
+  int x2 = GetTileId(fLeftBorder + fVPWidth - fXTileOffset);
+  int y1 = GetTileId(fTopBorder - fYTileOffset);
+  int y2 = GetTileId(fTopBorder + fVPHeight - fYTileOffset);
+
+  // Mark the tiles on screen as recently used, so that they outlive the new ones
+  for (int x = x1; x <= x2; x++) {
+    for (int y = y1; y <= y2; y++) {
+      auto iter = fTiles.find(GetTileKey(x, y));
+      if (iter != fTiles.end()) {
+        fTileLRU.splice(fTileLRU.begin(), fTileLRU, iter->second);
+      }
+    }
+  }
+
+  auto job = std::make_unique<PrefetchJob>();
+  auto add = [&](int xa, int xb, int ya, int yb) {
+    for (int x = xa; x <= xb; x++) {
+      for (int y = ya; y <= yb; y++) {
+        const TileKey key = GetTileKey(x, y);
+        if (fTiles.count(key) == 0 && std::find(job->fKeys.begin(), job->fKeys.end(), key) == job->fKeys.end()) {
+          job->fTiles.emplace_back(x, y);
+          job->fKeys.push_back(key);
+        }
+      }
+    }
+  };
+
+  // A positive shift moves the contents right (down), uncovering tiles on the left (top)
+  const bool all = (fPanX == 0 && fPanY == 0);
+  if (fPanX > 0 || all) {
+    add(x1 - 1, x1 - 1, y1 - 1, y2 + 1);
+  }
+  if (fPanX < 0 || all) {
+    add(x2 + 1, x2 + 1, y1 - 1, y2 + 1);
+  }
+  if (fPanY > 0 || all) {
+    add(x1 - 1, x2 + 1, y1 - 1, y1 - 1);
+  }
+  if (fPanY < 0 || all) {
+    add(x1 - 1, x2 + 1, y2 + 1, y2 + 1);
+  }
+  fPanX = fPanY = 0;
+  fPrefetchQueued = false;
+
+  if (job->fTiles.empty()) {
+    return;
+  }
+
+  // Only the filling of the images happens in the background (see RenderTiles())
+  for (std::size_t i = 0; i < job->fTiles.size(); i++) {
+    job->fImages.push_back(gVirtualX->CreateImage(cTileSize, cTileSize));
+  }
+  UpdatePixelTable(job->fImages.front());
+
+  PrefetchJob *j = job.get();
+  const double xzoom = fPainter.GetXZoom();
+  const double yzoom = fPainter.GetYZoom();
+  job->fThread = std::thread([this, j, xzoom, yzoom]() {
+    for (std::size_t i = 0; i < j->fTiles.size() && !j->fCancel; i++) {
+      FillTileImage(j->fImages[i], j->fTiles[i].first, j->fTiles[i].second, xzoom, yzoom);
+      ++j->fFilled;
+    }
+  });
+  fPrefetch = std::move(job);
+}
+
+//! Upload up to cPrefetchSlice of the tiles filled by the prefetch job, so that
+//! the GUI stays responsive, and finish the job once all of them are done
+void View2D::UploadPrefetched() {
+  PrefetchJob &job = *fPrefetch;
+  const std::size_t filled = job.fFilled;
+  for (int n = 0; n < cPrefetchSlice && job.fUploaded < filled; n++, job.fUploaded++) {
+    const std::size_t i = job.fUploaded;
+    if (fTiles.count(job.fKeys[i]) != 0) {
+      // Already rendered for the screen in the meantime
+      gVirtualX->DeleteImage(job.fImages[i]);
+    } else {
+      CacheTile(job.fKeys[i], UploadTile(job.fImages[i], job.fTiles[i].first, job.fTiles[i].second));
+    }
+  }
+
+  if (job.fUploaded == job.fTiles.size()) {
+    job.fThread.join();
+    fPrefetch.reset();
+  }
+}
+
+//! Stop the prefetch job and wait for its thread. Must be called before
+//! changing anything FillTileImage() reads, i.e. the zoom, the energy offsets
+//! and the color scale.
+void View2D::CancelPrefetch() {
+  if (!fPrefetch) {
+    return;
+  }
+
+  fPrefetch->fCancel = true;
+  fPrefetch->fThread.join();
+  for (std::size_t i = fPrefetch->fUploaded; i < fPrefetch->fImages.size(); i++) {
+    gVirtualX->DeleteImage(fPrefetch->fImages[i]);
+  }
+  fPrefetch.reset();
+}
+
 /* Copied from GSViewport: Merge? */
 Bool_t View2D::HandleMotion(Event_t *ev) {
   bool cv = fCursorVisible;
@@ -144,6 +370,8 @@ Bool_t View2D::HandleKey(Event_t *ev) {
   char buf[16];
 
   if (ev->fType == kGKeyPress) {
+    // Keys change the zoom or the color scale, which the prefetch job reads
+    CancelPrefetch();
     gVirtualX->LookupString(ev, buf, 16, keysym);
     switch (keysym) {
     case kKey_w:
@@ -187,6 +415,8 @@ void View2D::Update() {
 }
 
 void View2D::ZoomAroundCursor(double fx, double fy, Bool_t update) {
+  CancelPrefetch();
+
   // Convert offset to energy units
   fXEOffset += (fXTileOffset - fLeftBorder) / fPainter.GetXZoom();
   fYEOffset += (fYTileOffset - fTopBorder - fVPHeight) / fPainter.GetYZoom();
@@ -200,17 +430,25 @@ void View2D::ZoomAroundCursor(double fx, double fy, Bool_t update) {
 
   fPainter.SetXVisibleRegion(fPainter.GetXVisibleRegion() / fx);
   fPainter.SetYVisibleRegion(fPainter.GetYVisibleRegion() / fy);
+  AnchorTiles();
 
+  // Tiles are cached per zoom, so there is no need to flush them
   if (update) {
-    Update();
+    fPanX = fPanY = 0;
+    fPrefetchQueued = true;
+    SchedulePrefetch();
+    gClient->NeedRedraw(this);
+    UpdateStatusBar();
   }
 }
 
 void View2D::ZoomFull(Bool_t update) {
-  double xmin = fMatrix->GetXaxis()->GetXmin();
-  double ymin = fMatrix->GetYaxis()->GetXmin();
-  double xvis = fMatrix->GetXaxis()->GetXmax() - xmin;
-  double yvis = fMatrix->GetYaxis()->GetXmax() - ymin;
+  CancelPrefetch();
+
+  double xmin = fSource->GetXmin();
+  double ymin = fSource->GetYmin();
+  double xvis = fSource->GetXmax() - xmin;
+  double yvis = fSource->GetYmax() - ymin;
 
   fPainter.SetXVisibleRegion(xvis);
   fPainter.SetYVisibleRegion(yvis);
@@ -219,12 +457,27 @@ void View2D::ZoomFull(Bool_t update) {
 
   fXTileOffset = fLeftBorder;
   fYTileOffset = fTopBorder + fVPHeight;
+  AnchorTiles();
 
   if (update) {
-    Update();
+    fPanX = fPanY = 0;
+    fPrefetchQueued = true;
+    SchedulePrefetch();
+    gClient->NeedRedraw(this);
+    UpdateStatusBar();
   }
 }
 
+//! Move the energy offsets into the pixel offsets, rounding the view to whole
+//! pixels. This anchors the tile grid at energy zero, so that tiles rendered
+//! at a given zoom are valid regardless of how far the view has been moved.
+void View2D::AnchorTiles() {
+  fXTileOffset += std::lround(fXEOffset * fPainter.GetXZoom());
+  fYTileOffset += std::lround(fYEOffset * fPainter.GetYZoom());
+  fXEOffset = 0.0;
+  fYEOffset = 0.0;
+}
+
 double View2D::Log(double x) {
   if (x < 0.0) {
     return 0.0;
@@ -292,11 +545,30 @@ void View2D::ZtoRGB(int z, int &r, int &g, int &b) {
   }
 }
 
-int View2D::GetValueAtPixel(int x, int y) {
-  double z;
+//! Make sure the pixel table matches the visual of img (which must be an XImage)
+void View2D::UpdatePixelTable(Drawable_t img) {
+  const XImage *x_img = reinterpret_cast<XImage *>(img);
+  if (!fPixelTable.empty() && fPixelTableMasks[0] == x_img->red_mask && fPixelTableMasks[1] == x_img->green_mask &&
+      fPixelTableMasks[2] == x_img->blue_mask) {
+    return;
+  }
+
+  const PixelFormat fmt(x_img);
+  int r, g, b;
+  fPixelTable.resize(cZColorRange + 2);
+  for (int z = -1; z <= cZColorRange; z++) {
+    ZtoRGB(z, r, g, b);
+    fPixelTable[z + 1] = fmt.Pixel(r, g, b);
+  }
+
+  fPixelTableMasks[0] = x_img->red_mask;
+  fPixelTableMasks[1] = x_img->green_mask;
+  fPixelTableMasks[2] = x_img->blue_mask;
+}
 
-  z = fMatrix->GetBinContent(fMatrix->FindBin(XTileToE(x), YTileToE(y)));
+int View2D::GetValueAtPixel(int x, int y) { return ValueToScr(fSource->GetValueAt(XTileToE(x), YTileToE(y))); }
 
+int View2D::ValueToScr(double z) {
   if (fLogScale) {
     z = Log(z);
   }
@@ -305,63 +577,104 @@ int View2D::GetValueAtPixel(int x, int y) {
 }
 
 Pixmap_t View2D::RenderTile(int xoff, int yoff) {
-  int x, y, z;
-  int r, g, b;
-  Pixmap_t pixmap;
-  Drawable_t img;
-  ULong_t pixel;
-  unsigned long r_mask, g_mask, b_mask;
-  int r_shift, g_shift, b_shift;
+  Drawable_t img = gVirtualX->CreateImage(cTileSize, cTileSize);
+  UpdatePixelTable(img);
+  FillTileImage(img, xoff, yoff);
+  return UploadTile(img, xoff, yoff);
+}
 
-  img = gVirtualX->CreateImage(cTileSize, cTileSize);
+//! Render all tiles from (x1, y1) to (x2, y2) (inclusive) which are not cached
+//! yet. The images are filled by a pool of worker threads; only the creation
+//! and upload of images and pixmaps happens on the calling (GUI) thread.
+void View2D::RenderTiles(int x1, int x2, int y1, int y2) {
+  std::vector<std::pair<int, int>> missing;
+  for (int x = x1; x <= x2; x++) {
+    for (int y = y1; y <= y2; y++) {
+      auto iter = fTiles.find(GetTileKey(x, y));
+      if (iter == fTiles.end()) {
+        missing.emplace_back(x, y);
+      } else {
+        // Keep cached tiles from being evicted in favour of the new ones
+        fTileLRU.splice(fTileLRU.begin(), fTileLRU, iter->second);
+      }
+    }
+  }
 
-  /* Calculate shifts required for color channels. Positive shifts go to the
-     left, negative shifts go to the right.
+  if (missing.empty()) {
+    return;
+  }
 
-     NOTE: This code only works as long as the bit mask for each color channel
-     contains only a single, continuous strings of 1s. Otherwise, much more
-     complicated and slow code would be needed, as a single shift would no
-     longer be sufficient.   */
-  const XImage *x_img = reinterpret_cast<XImage *>(img);
-  r_mask = x_img->red_mask;
-  g_mask = x_img->green_mask;
-  b_mask = x_img->blue_mask;
+  std::vector<Drawable_t> images(missing.size());
+  for (auto &img : images) {
+    img = gVirtualX->CreateImage(cTileSize, cTileSize);
+  }
+  UpdatePixelTable(images.front());
 
-  r_shift = g_shift = b_shift = 0;
-  while (r_mask) {
-    r_mask >>= 1;
-    r_shift++;
+  std::atomic<std::size_t> next{0};
+  auto worker = [&]() {
+    for (std::size_t i = next++; i < missing.size(); i = next++) {
+      FillTileImage(images[i], missing[i].first, missing[i].second);
+    }
+  };
+
+  const std::size_t nThreads = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), missing.size());
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < nThreads; i++) {
+    threads.emplace_back(worker);
   }
-  r_shift -= 8;
-  while (g_mask) {
-    g_mask >>= 1;
-    g_shift++;
+  worker();
+  for (auto &thread : threads) {
+    thread.join();
   }
-  g_shift -= 8;
-  while (b_mask) {
-    b_mask >>= 1;
-    b_shift++;
+
+  for (std::size_t i = 0; i < missing.size(); i++) {
+    const auto &tile = missing[i];
+    CacheTile(GetTileKey(tile.first, tile.second), UploadTile(images[i], tile.first, tile.second));
   }
-  b_shift -= 8;
+}
+
+//! Fill the image of a tile with the matrix contents. Only reads the matrix,
+//! the current zoom and the pixel table (see UpdatePixelTable()), and writes
+//! to img, so this may run in a worker thread.
+void View2D::FillTileImage(Drawable_t img, int xoff, int yoff) {
+  FillTileImage(img, xoff, yoff, fPainter.GetXZoom(), fPainter.GetYZoom());
+}
 
-  r_mask = x_img->red_mask;
-  g_mask = x_img->green_mask;
-  b_mask = x_img->blue_mask;
+//! Same, with the zoom given explicitly, for threads that run while the
+//! painter is in use (the painter updates its zoom when redrawing)
+void View2D::FillTileImage(Drawable_t img, int xoff, int yoff, double xzoom, double yzoom) {
+  XImage *x_img = reinterpret_cast<XImage *>(img);
+  const bool native = HasNative32BitPixels(x_img);
+
+  double xe[cTileSize], ye[cTileSize];
+  for (int x = 0; x < cTileSize; x++) {
+    xe[x] = (x + xoff * cTileSize) / xzoom - fXEOffset;
+  }
+  for (int y = 0; y < cTileSize; y++) {
+    ye[y] = -(y + yoff * cTileSize) / yzoom + fYEOffset;
+  }
 
-  for (y = 0; y < cTileSize; y++) {
-    for (x = 0; x < cTileSize; x++) {
-      z = GetValueAtPixel(x + xoff * cTileSize, -(y + yoff * cTileSize));
-      ZtoRGB(z, r, g, b);
+  std::vector<double> values(cTileSize * cTileSize);
+  // When zoomed out, show the maximum of the bins under each pixel
+  fSource->GetMaxValues(xe, cTileSize, ye, cTileSize, 1.0 / xzoom, 1.0 / yzoom, values.data());
 
-      r = (r_shift > 0) ? (r << r_shift) : (r >> (-r_shift));
-      g = (g_shift > 0) ? (g << g_shift) : (g >> (-g_shift));
-      b = (b_shift > 0) ? (b << b_shift) : (b >> (-b_shift));
-      pixel = (r & r_mask) | (g & g_mask) | (b & b_mask);
-      gVirtualX->PutPixel(img, x, y, pixel);
+  for (int y = 0; y < cTileSize; y++) {
+    const double *row = values.data() + y * cTileSize;
+    auto *line = reinterpret_cast<uint32_t *>(x_img->data + y * x_img->bytes_per_line);
+    for (int x = 0; x < cTileSize; x++) {
+      if (native) {
+        line[x] = ZToPixel(ValueToScr(row[x]));
+      } else {
+        XPutPixel(x_img, x, y, ZToPixel(ValueToScr(row[x])));
+      }
     }
   }
+}
 
-  pixmap = gVirtualX->CreatePixmap(GetId(), cTileSize, cTileSize);
+//! Copy a filled tile image to a new pixmap and draw the cuts on top of it.
+//! The image is deleted.
+Pixmap_t View2D::UploadTile(Drawable_t img, int xoff, int yoff) {
+  Pixmap_t pixmap = gVirtualX->CreatePixmap(GetId(), cTileSize, cTileSize);
   if (fDarkMode) {
     gVirtualX->PutImage(pixmap, GetWhiteGC()(), img, 0, 0, 0, 0, cTileSize, cTileSize);
   } else {
@@ -418,60 +731,67 @@ void View2D::DrawPolyLine(Drawable_t id, GContext_t gc, Int_t n, short *points)
              reinterpret_cast<GC>(gc), reinterpret_cast<XPoint *>(points), n, CoordModeOrigin);
 }
 
-template <typename ContainerT, typename Cond> void erase_if(ContainerT &container, Cond cond) {
-  auto it = container.begin();
-  while (it != container.end()) {
-    if (cond(*it)) {
-      it = container.erase(it);
-    } else {
-      ++it;
-    }
+//! Destroy all tiles in the cache, causing them to be redrawn when needed (e.g.
+//! after the color scale or the cuts changed)
+void View2D::FlushTiles() {
+  CancelPrefetch();
+  for (auto &tile : fTileLRU) {
+    gVirtualX->DeletePixmap(tile.pixmap);
   }
+  fTileLRU.clear();
+  fTiles.clear();
 }
 
-void View2D::WeedTiles() {
-  erase_if(fTiles, [&](decltype(fTiles)::value_type &tile) {
-    int16_t x = tile.first & 0xFFFF;
-    int16_t y = tile.first >> 16;
-    int xpos = x * cTileSize + fXTileOffset;
-    int ypos = y * cTileSize + fYTileOffset;
+//! Set the amount of memory (in bytes, assuming 32 bit pixels) that cached
+//! tiles may use. The tiles on screen are always kept.
+void View2D::SetTileCacheSize(std::size_t bytes) {
+  fTileCacheSize = bytes;
+  EvictTiles();
+}
 
-    if (xpos < -2 * cTileSize || xpos > static_cast<int>(fWidth) + cTileSize || ypos < -2 * cTileSize ||
-        ypos > static_cast<int>(fHeight) + cTileSize) {
-      // cout << "Deleting Tile " << x << " " << y << " " << xpos << " " << ypos
-      // << endl;
-      gVirtualX->DeletePixmap(tile.second);
-      return true;
-    }
-    return false;
-  });
+View2D::TileKey View2D::GetTileKey(int x, int y) {
+  // Zooms are compared on a logarithmic scale with a resolution of 2^-20, so
+  // that zooming in and out again finds the same tiles despite rounding errors
+  return TileKey(std::llround(std::log2(fPainter.GetXZoom()) * (1 << 20)),
+                 std::llround(std::log2(fPainter.GetYZoom()) * (1 << 20)), x, y);
 }
 
-//! Destroy all tiles in the cache, causing them to be redrawn when needed (e.g.
-//! after a zoom level change)
-void View2D::FlushTiles() {
-  for (auto &tile : fTiles) {
-    gVirtualX->DeletePixmap(tile.second);
+void View2D::CacheTile(const TileKey &key, Pixmap_t pixmap) {
+  fTileLRU.push_front(Tile{key, pixmap});
+  fTiles[key] = fTileLRU.begin();
+  EvictTiles();
+}
+
+//! Delete the least recently used tiles while the cache is over its budget
+void View2D::EvictTiles() {
+  const std::size_t tileBytes = cTileSize * cTileSize * 4;
+  const std::size_t maxTiles = std::max(fTileCacheSize / tileBytes, fVisibleTiles);
+  while (fTileLRU.size() > maxTiles) {
+    gVirtualX->DeletePixmap(fTileLRU.back().pixmap);
+    fTiles.erase(fTileLRU.back().key);
+    fTileLRU.pop_back();
   }
-  fTiles.clear();
 }
 
 Pixmap_t View2D::GetTile(int x, int y) {
-  uint32_t id = (y << 16) | (x & 0xFFFF);
+  const TileKey key = GetTileKey(x, y);
 
-  auto iter = fTiles.find(id);
+  auto iter = fTiles.find(key);
   if (iter == fTiles.end()) {
     Pixmap_t tile = RenderTile(x, y);
     // cout << "Rendering Tile " << x << " " << y << endl;
-    fTiles.insert(std::make_pair(id, tile));
+    CacheTile(key, tile);
     return tile;
   } else {
-    return iter->second;
+    fTileLRU.splice(fTileLRU.begin(), fTileLRU, iter->second);
+    return iter->second->pixmap;
   }
 }
 
 //! Callback for changes in size of our screen area
 void View2D::Layout() {
+  CancelPrefetch();
+
   // Convert offset to energy units
   fXEOffset += (fXTileOffset - fLeftBorder) / fPainter.GetXZoom();
   fYEOffset += (fYTileOffset - fTopBorder - fVPHeight) / fPainter.GetYZoom();
@@ -484,8 +804,7 @@ void View2D::Layout() {
 
   fPainter.SetBasePoint(fLeftBorder, fHeight - fBottomBorder);
   fPainter.SetSize(fVPWidth, fVPHeight);
-
-  FlushTiles();
+  AnchorTiles();
 }
 
 void View2D::DoRedraw() {
@@ -493,7 +812,6 @@ void View2D::DoRedraw() {
   int x1, y1, x2, y2;
   bool cv = fCursorVisible;
   Pixmap_t tile;
-  unsigned int NTiles;
   int src_x, src_y, width, height, dest_x, dest_y;
 
   x1 = GetTileId(fLeftBorder - fXTileOffset);
@@ -507,6 +825,10 @@ void View2D::DoRedraw() {
 
   // gVirtualX->FillRectangle(GetId(), GetWhiteGC()(), 0, 0, fWidth, fHeight);
 
+  fVisibleTiles = (x2 - x1 + 1) * (y2 - y1 + 1);
+
+  RenderTiles(x1, x2, y1, y2);
+
   for (x = x1; x <= x2; x++) {
     for (y = y1; y <= y2; y++) {
       tile = GetTile(x, y);
@@ -565,11 +887,6 @@ void View2D::DoRedraw() {
     DrawCursor();
   }
 
-  NTiles = (fWidth / cTileSize + 4) * (fHeight / cTileSize + 4);
-  if (fTiles.size() > NTiles) {
-    // cout << "Weeding..." << endl;
-    WeedTiles();
-  }
 }
 
 void View2D::SetDarkMode(bool dark) {
@@ -584,6 +901,9 @@ void View2D::SetDarkMode(bool dark) {
     fPainter.SetClearGC(GetWhiteGC().GetGC());
   }
 
+  // The cuts are drawn into the cached tiles in a colour that depends on the
+  // mode, so the tiles have to be rendered again.
+  FlushTiles();
   gClient->NeedRedraw(this, true);
 }
 
@@ -32,15 +32,23 @@ typedef unsigned int uint32_t;
 
 #include <cmath>
 
+#include <algorithm>
 #include <list>
 #include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include <TTimer.h>
 
 #include "DisplayCut.hh"
+#include "MatrixSource.hh"
 #include "Painter.hh"
 #include "View.hh"
 
 class TGStatusBar;
 class TH2;
+class THnSparse;
 
 namespace HDTV {
 namespace Display {
@@ -49,14 +57,21 @@ namespace Display {
 class View2D : public View {
 public:
   View2D(const TGWindow *p, UInt_t w, UInt_t h, TH2 *mat);
+  View2D(const TGWindow *p, UInt_t w, UInt_t h, THnSparse *mat);
+  View2D(const TGWindow *p, UInt_t w, UInt_t h, std::unique_ptr<MatrixSource> source);
   ~View2D() override;
 
   Pixmap_t RenderTile(int xoff, int yoff);
+  void RenderTiles(int x1, int x2, int y1, int y2);
+  void FillTileImage(Drawable_t img, int xoff, int yoff);
+  void FillTileImage(Drawable_t img, int xoff, int yoff, double xzoom, double yzoom);
+  Pixmap_t UploadTile(Drawable_t img, int xoff, int yoff);
   void RenderCuts(int xoff, int yoff, Pixmap_t pixmap);
   void RenderCut(const DisplayCut &cut, int xoff, int yoff, Pixmap_t pixmap);
   Pixmap_t GetTile(int x, int y);
   void FlushTiles();
-  void WeedTiles();
+  void SetTileCacheSize(std::size_t bytes);
+  std::size_t GetTileCacheSize() { return fTileCacheSize; }
   void DoRedraw() override;
   void Layout() override;
   void Update();
@@ -99,22 +114,64 @@ public:
   */
 
   void ShiftOffset(int dX, int dY);
+  Bool_t HandleTimer(TTimer *timer) override;
 
   // Calculate floor(pos / cTileSize)
   int GetTileId(int pos) { return pos < 0 ? (pos / cTileSize) - 1 : pos / cTileSize; }
 
   void ZtoRGB(int z, int &r, int &g, int &b);
+  void UpdatePixelTable(Drawable_t img);
+
+  //! X pixel value for the color of z (see ZtoRGB()), from the pixel table
+  ULong_t ZToPixel(int z) const { return fPixelTable[std::min(std::max(z + 1, 0), cZColorRange + 1)]; }
   int GetValueAtPixel(int xs, int ys);
+  int ValueToScr(double z);
   bool GetDarkMode() { return fDarkMode; }
 
 protected:
   std::list<DisplayCut> fCuts;
 
-  std::map<uint32_t, Pixmap_t> fTiles;
+  //! Tiles are identified by the zoom they were rendered at and their position
+  using TileKey = std::tuple<int64_t, int64_t, int, int>;
+  struct Tile {
+    TileKey key;
+    Pixmap_t pixmap;
+  };
+
+  TileKey GetTileKey(int x, int y);
+  void CacheTile(const TileKey &key, Pixmap_t pixmap);
+  void EvictTiles();
+  void AnchorTiles();
+
+  struct PrefetchJob;
+  void SchedulePrefetch();
+  void StartPrefetch();
+  void UploadPrefetched();
+  void CancelPrefetch();
+
+  // Rendered tiles, most recently used first, and an index into this list
+  std::list<Tile> fTileLRU;                            //!
+  std::map<TileKey, std::list<Tile>::iterator> fTiles; //!
+  std::size_t fTileCacheSize;                          // in bytes
+  std::size_t fVisibleTiles;                           // tiles on screen, never evicted
+
+  // Rendering of the tiles next to the screen, in the direction of the last
+  // shift (fPanX, fPanY: -1, 0 or 1), or all around it after a zoom. The
+  // images are filled in a background thread; the timer starts the job
+  // shortly after the view was moved and then uploads the finished tiles a
+  // few at a time.
+  std::unique_ptr<TTimer> fPrefetchTimer; //!
+  std::unique_ptr<PrefetchJob> fPrefetch; //!
+  bool fPrefetchPending, fPrefetchQueued;
+  int fPanX, fPanY;
+
+  // Pixel values for z = -1 ... cZColorRange, valid for images with the color masks in fPixelTableMasks
+  std::vector<ULong_t> fPixelTable;              //!
+  unsigned long fPixelTableMasks[3] = {0, 0, 0}; //!
   double fZVisibleRegion;
   Bool_t fLogScale;
 
-  TH2 *fMatrix;
+  std::unique_ptr<MatrixSource> fSource; //!
   double fMatrixMax;
 
   double fXEOffset, fYEOffset;
@@ -125,6 +182,8 @@ protected:
 
   static const int cZColorRange = 5 * 256;
   static const int cTileSize = 128;
+  static const int cPrefetchDelay = 20; // ms
+  static const int cPrefetchSlice = 4;  // tiles uploaded per timer tick
 
   Painter fPainter;
 
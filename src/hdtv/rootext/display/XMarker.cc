@@ -21,6 +21,9 @@
  */
 
 #include "XMarker.hh"
+
+#include <algorithm>
+
 #include <TGX11.h>
 
 namespace HDTV {
@@ -30,6 +33,18 @@ XMarker::XMarker(int n, double p1, double p2, int col) : Marker(n, p1, p2, col),
   fConnectTop = true;
 }
 
+bool XMarker::GetERange(Painter &painter, double &e1, double &e2, int &margin) {
+  e1 = e2 = GetE1();
+  if (GetN() > 1) {
+    e1 = std::min(e1, GetE2());
+    e2 = std::max(e2, GetE2());
+  }
+
+  // The ID is drawn to the right of the first marker
+  margin = GetWidth(painter.GetFontStruct()) + 2;
+  return true;
+}
+
 int XMarker::GetWidth(const FontStruct_t &fs) {
   if (GetID().empty()) {
     return 0;
@@ -64,6 +64,8 @@ public:
 
   int GetWidth(const FontStruct_t &fs);
 
+  bool GetERange(Painter &painter, double &e1, double &e2, int &margin) override;
+
   void PaintRegion(UInt_t x1, UInt_t x2, Painter &painter) override {
     if (IsVisible()) {
       painter.DrawXMarker(this, x1, x2);
@@ -1,3 +1,10 @@
+import ROOT
+
 import hdtv.rootext.dlmgr
 
 hdtv.rootext.dlmgr.LoadLibrary("fit")
+
+# Process-wide, so it is switched on once at startup, before the first fit
+# (needed by the parallel bootstrap). TH1::Fit then no longer updates
+# TVirtualFitter, so covariances are taken from the returned TFitResult.
+ROOT.EnableThreadSafety()
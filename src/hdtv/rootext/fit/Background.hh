@@ -25,6 +25,8 @@
 
 #include <limits>
 
+#include "FitStats.hh"
+
 class TF1;
 
 namespace HDTV {
@@ -43,6 +45,10 @@ public:
   virtual unsigned int GetNparams() const { return 0; };
   virtual double Eval(double /*x*/) const { return std::numeric_limits<double>::quiet_NaN(); }
   virtual double EvalError(double /*x*/) const { return std::numeric_limits<double>::quiet_NaN(); }
+  const FitStats &GetFitStats() const { return fStats; }
+
+protected:
+  FitStats fStats;
 
 private:
   Background(const Background & /*b*/) = default;
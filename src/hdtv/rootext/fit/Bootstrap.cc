@@ -0,0 +1,287 @@
+/*
+ * HDTV - A ROOT-based spectrum analysis software
+ *  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+ *
+ * This file is part of HDTV.
+ *
+ * HDTV is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * HDTV is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HDTV; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ */
+
+#include "Bootstrap.hh"
+
+#include <cmath>
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <random>
+#include <thread>
+
+#include <Fit/Fitter.h>
+#include <Math/Factory.h>
+#include <Math/Functor.h>
+#include <Math/Minimizer.h>
+#include <Math/MinimizerOptions.h>
+#include <TError.h>
+#include <TF1.h>
+#include <TH1.h>
+#include <TVirtualMutex.h>
+
+#include "Likelihood.hh"
+#include "TheuerkaufFitter.hh"
+#include "Util.hh"
+
+namespace HDTV {
+namespace Fit {
+
+//! Copies of the fitter and the histogram, used by one thread at a time
+struct Bootstrap::Replica {
+  std::unique_ptr<TheuerkaufFitter> fFitter;
+  std::unique_ptr<TH1> fHist;
+};
+
+Bootstrap::Bootstrap(const TheuerkaufFitter &fitter, const TH1 &hist, Mode mode)
+    : fFitter(fitter), fHist(static_cast<TH1 *>(hist.Clone())), fMode(mode), fNumReplicas(0) {
+  fHist->SetDirectory(nullptr);
+
+  TF1 *func = fitter.fSumFunc.get();
+  if (!fitter.IsFinal() || func == nullptr) {
+    Warning("HDTV::Bootstrap::Bootstrap", "fitter has not been fitted yet");
+    return;
+  }
+  fNominal.assign(func->GetParameters(), func->GetParameters() + func->GetNpar());
+
+  // Same bins as used by the fit, see BinnedObjective. For a parametric
+  // bootstrap, the expected counts are calculated the same way as in the fit.
+  bool integrate = fitter.fIntegrate.GetValue();
+  for (int b = 1; b <= hist.GetNbinsX(); ++b) {
+    double center = hist.GetBinCenter(b);
+    if (center < fitter.fMin || center > fitter.fMax) {
+      continue;
+    }
+    fBins.push_back(b);
+
+    double mean = hist.GetBinContent(b);
+    if (fMode == kParametric && integrate) {
+      double halfWidth = hist.GetBinWidth(b) / 2.0;
+      mean = 0.0;
+      for (int k = 0; k < cGaussLegendreOrder; ++k) {
+        double x = center + halfWidth * cGaussLegendreNodes[k];
+        mean += cGaussLegendreWeights[k] / 2.0 * func->EvalPar(&x, fNominal.data());
+      }
+    } else if (fMode == kParametric) {
+      mean = func->EvalPar(&center, fNominal.data());
+    }
+    fMean.push_back(std::max(mean, 0.0));
+  }
+}
+
+Bootstrap::~Bootstrap() = default;
+
+//! Private: copy the fitter with the result of the nominal fit, so that the
+//! copy can be refitted independently. Creates ROOT objects, so must be called
+//! from the main thread.
+std::unique_ptr<Bootstrap::Replica> Bootstrap::MakeReplica() const {
+  auto replica = std::make_unique<Replica>();
+  replica->fHist.reset(static_cast<TH1 *>(fHist->Clone()));
+  replica->fHist->SetDirectory(nullptr);
+  if (replica->fHist->GetSumw2N() == 0) {
+    replica->fHist->Sumw2();
+  }
+
+  const TheuerkaufFitter &src = fFitter;
+  replica->fFitter = std::make_unique<TheuerkaufFitter>(src.fMin, src.fMax, src.fIntegrate, src.fLikelihood,
+                                                        src.fOnlypositivepeaks);
+  TheuerkaufFitter &fitter = *replica->fFitter;
+  fitter.fNumParams = src.fNumParams;
+  fitter.fIntNParams = src.fIntNParams;
+  if (src.fBackground) {
+    fitter.fBackground.reset(src.fBackground->Clone());
+  }
+  fitter.fWidthModel = src.fWidthModel;
+  for (const auto &peak : src.fPeaks) {
+    fitter.fPeaks.push_back(peak);
+    if (peak.fWidthModel) {
+      fitter.fPeaks.back().fWidthModel = &fitter.fWidthModel;
+    }
+  }
+  fitter.fNumPeaks = src.fNumPeaks;
+
+  // Errors of the nominal fit serve as step sizes; limits are kept
+  const TF1 &srcFunc = *src.fSumFunc;
+  fitter.fSumFunc = std::make_unique<TF1>(GetFuncUniqueName("f", &fitter).c_str(), &fitter, &TheuerkaufFitter::Eval,
+                                          src.fMin, src.fMax, src.fNumParams, "TheuerkaufFitter", "Eval");
+  for (int i = 0; i < src.fNumParams; ++i) {
+    double lower, upper;
+    srcFunc.GetParLimits(i, lower, upper);
+    fitter.fSumFunc->SetParameter(i, srcFunc.GetParameter(i));
+    fitter.fSumFunc->SetParError(i, srcFunc.GetParError(i));
+    fitter.fSumFunc->SetParLimits(i, lower, upper);
+  }
+  for (auto &peak : fitter.fPeaks) {
+    peak.SetSumFunc(fitter.fSumFunc.get());
+  }
+
+  return replica;
+}
+
+//! Private: draw replica number index and fit it, starting at the nominal
+//! result. Stores the fitted parameters in params and returns true on success.
+bool Bootstrap::FitReplica(Replica &replica, unsigned int seed, int index, std::vector<double> &params) const {
+  std::seed_seq seq{seed, static_cast<unsigned int>(index)};
+  std::mt19937 rng(seq);
+  TH1 &hist = *replica.fHist;
+  for (std::size_t i = 0; i < fBins.size(); ++i) {
+    double n = fMean[i] > 0.0 ? std::poisson_distribution<long>(fMean[i])(rng) : 0.0;
+    hist.SetBinContent(fBins[i], n);
+    hist.SetBinError(fBins[i], std::sqrt(n));
+  }
+
+  TheuerkaufFitter &fitter = *replica.fFitter;
+  TF1 &func = *fitter.fSumFunc;
+  func.SetParameters(fNominal.data());
+  auto objective = MakeObjective(hist, func, fitter.fIntegrate.GetValue(), fitter.fLikelihood.GetValue());
+
+  int npar = fNominal.size();
+  ROOT::Fit::Fitter minimizer;
+  minimizer.Config().SetMinimizer(fMinimizer.c_str());
+  minimizer.Config().SetParamsSettings(npar, fNominal.data());
+  for (int i = 0; i < npar; ++i) {
+    CopyParamSettings(minimizer.Config().ParSettings(i), func, i);
+  }
+
+  ROOT::Math::Functor fcn([&objective](const double *p) { return (*objective)(p); }, npar);
+  if (!minimizer.FitFCN(fcn, nullptr, objective->GetNPoints(), true) || !minimizer.Result().IsValid()) {
+    return false;
+  }
+  params = minimizer.Result().Parameters();
+  return true;
+}
+
+int Bootstrap::Run(int nReplicas, unsigned int seed, int nThreads) {
+  fSamples.clear();
+  fNumReplicas = 0;
+  if (fNominal.empty() || nReplicas <= 0) {
+    return 0;
+  }
+  fNumReplicas = nReplicas;
+
+  // Minuit2, unlike the original Minuit, can be used from several threads at
+  // once. Loading it here also keeps the plugin manager out of the threads.
+  // Thread safety is process-wide and is not switched on here: it changes
+  // the behaviour of TH1::Fit for all later fits.
+  std::unique_ptr<ROOT::Math::Minimizer> probe(ROOT::Math::Factory::CreateMinimizer("Minuit2"));
+  if (probe) {
+    fMinimizer = "Minuit2";
+  } else {
+    Warning("HDTV::Bootstrap::Run", "Minuit2 not available, fitting replicas in a single thread");
+    fMinimizer = ROOT::Math::MinimizerOptions::DefaultMinimizerType();
+    nThreads = 1;
+  }
+  if (gGlobalMutex == nullptr && nThreads != 1) {
+    Warning("HDTV::Bootstrap::Run", "ROOT thread safety not enabled, fitting replicas in a single thread");
+    nThreads = 1;
+  }
+  if (nThreads <= 0) {
+    nThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  nThreads = std::min(nThreads, nReplicas);
+
+  std::vector<std::unique_ptr<Replica>> replicas;
+  for (int t = 0; t < nThreads; ++t) {
+    replicas.push_back(MakeReplica());
+  }
+
+  // Replicas are handed out one by one, as their fits take different times
+  std::vector<std::vector<double>> results(nReplicas);
+  std::vector<char> success(nReplicas, false);
+  std::atomic<int> next{0};
+  auto work = [&](Replica *replica) {
+    for (int r = next++; r < nReplicas; r = next++) {
+      success[r] = FitReplica(*replica, seed, r, results[r]);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int t = 1; t < nThreads; ++t) {
+    threads.emplace_back(work, replicas[t].get());
+  }
+  work(replicas[0].get());
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (int r = 0; r < nReplicas; ++r) {
+    if (success[r]) {
+      fSamples.push_back(std::move(results[r]));
+    }
+  }
+  return fSamples.size();
+}
+
+std::vector<double> Bootstrap::GetSamples(int peak, const std::string &name) const {
+  std::vector<double> values;
+  if (peak < 0 || peak >= static_cast<int>(fFitter.fPeaks.size())) {
+    Warning("HDTV::Bootstrap::GetSamples", "no peak with index %d", peak);
+    return values;
+  }
+  const TheuerkaufPeak &p = fFitter.fPeaks[peak];
+  const Param *param = p.GetParam(name);
+  if (param == nullptr) {
+    Warning("HDTV::Bootstrap::GetSamples", "unknown parameter %s", name.c_str());
+    return values;
+  }
+
+  values.reserve(fSamples.size());
+  for (const auto &sample : fSamples) {
+    values.push_back(name == "width" ? p.Sigma(sample.data()) : param->Value(sample.data()));
+  }
+  return values;
+}
+
+double Bootstrap::GetMean(int peak, const std::string &name) const {
+  auto values = GetSamples(peak, name);
+  if (values.empty()) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  return std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+}
+
+double Bootstrap::GetStdDev(int peak, const std::string &name) const {
+  auto values = GetSamples(peak, name);
+  if (values.size() < 2) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  double mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+  double sum2 = std::accumulate(values.begin(), values.end(), 0.0,
+                                [mean](double sum, double value) { return sum + (value - mean) * (value - mean); });
+  return std::sqrt(sum2 / (values.size() - 1));
+}
+
+double Bootstrap::GetPercentile(int peak, const std::string &name, double q) const {
+  auto values = GetSamples(peak, name);
+  if (values.empty() || q < 0.0 || q > 1.0) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  std::sort(values.begin(), values.end());
+  double pos = q * (values.size() - 1);
+  std::size_t i = std::min<std::size_t>(pos, values.size() - 1);
+  std::size_t j = std::min(i + 1, values.size() - 1);
+  return values[i] + (pos - i) * (values[j] - values[i]);
+}
+
+} // end namespace Fit
+} // end namespace HDTV
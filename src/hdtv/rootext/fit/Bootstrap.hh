@@ -0,0 +1,103 @@
+/*
+ * HDTV - A ROOT-based spectrum analysis software
+ *  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+ *
+ * This file is part of HDTV.
+ *
+ * HDTV is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * HDTV is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HDTV; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ */
+
+#ifndef __Bootstrap_h__
+#define __Bootstrap_h__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class TH1;
+
+namespace HDTV {
+namespace Fit {
+
+class TheuerkaufFitter;
+
+//! Resampling estimate of the uncertainties of a TheuerkaufFitter fit
+/**
+ * Replicas of the spectrum in the fit region are drawn either by Poisson
+ * fluctuation of the measured bin contents, or of the fitted model (a
+ * parametric bootstrap). Each replica is refitted, starting from the result
+ * of the nominal fit, and the spread of the results over all replicas gives
+ * the uncertainties. This is more reliable than the errors from the curvature
+ * of the chi^2 for peaks with few counts. The replicas are fitted in parallel
+ * on copies of the fitter; the result of a given replica only depends on the
+ * seed, not on the number of threads. Running more than one thread requires
+ * Minuit2 and ROOT's thread safety, which is enabled when the library is
+ * loaded from python.
+ *
+ * A background fitted together with the peaks is refitted in each replica. An
+ * external background is not resampled: it was fitted to the background
+ * regions, which lie outside the fit region and are not part of the replicas,
+ * and it is fixed during the peak fit. Its uncertainty is therefore not
+ * included in the bootstrap spread.
+ */
+class Bootstrap {
+public:
+  enum Mode { kPoisson, kParametric };
+
+  //! The fitter must already have been fitted to hist, and must outlive the
+  //! Bootstrap object
+  Bootstrap(const TheuerkaufFitter &fitter, const TH1 &hist, Mode mode = kPoisson);
+  ~Bootstrap();
+
+  // Copying is not supported
+  Bootstrap(const Bootstrap &) = delete;
+  Bootstrap &operator=(const Bootstrap &) = delete;
+
+  //! Fit nReplicas replicas, using nThreads threads (0: one per core).
+  //! Returns the number of successful fits.
+  int Run(int nReplicas, unsigned int seed = 0, int nThreads = 0);
+
+  int GetNumReplicas() const { return fNumReplicas; }
+  int GetNumConverged() const { return fSamples.size(); }
+
+  //! Values of a parameter ("pos", "vol", "width", "tl", "tr", "sh" or "sw";
+  //! width as sigma) of a peak, one for each successful replica fit
+  std::vector<double> GetSamples(int peak, const std::string &name) const;
+  double GetMean(int peak, const std::string &name) const;
+  double GetStdDev(int peak, const std::string &name) const;
+  //! q-th quantile (0 <= q <= 1), linearly interpolated between the samples
+  double GetPercentile(int peak, const std::string &name, double q) const;
+
+private:
+  struct Replica;
+  std::unique_ptr<Replica> MakeReplica() const;
+  bool FitReplica(Replica &replica, unsigned int seed, int index, std::vector<double> &params) const;
+
+  const TheuerkaufFitter &fFitter; //!
+  std::unique_ptr<TH1> fHist;      //!
+  Mode fMode;
+  std::vector<int> fBins;                    // histogram bins in the fit region
+  std::vector<double> fMean;                 // counts the replicas fluctuate around
+  std::vector<double> fNominal;              // parameters of the nominal fit
+  std::vector<std::vector<double>> fSamples; // parameters of each successful replica fit
+  std::string fMinimizer;
+  int fNumReplicas;
+};
+
+} // end namespace Fit
+} // end namespace HDTV
+
+#endif
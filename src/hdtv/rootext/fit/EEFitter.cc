@@ -31,8 +31,8 @@
 #include <TError.h>
 #include <TF1.h>
 #include <TH1.h>
-#include <TVirtualFitter.h>
 
+#include "Likelihood.hh"
 #include "Util.hh"
 
 namespace HDTV {
@@ -135,10 +135,8 @@ TF1 *EEPeak::GetPeakFunc() {
 //! Initialize fVol and fVolError
 //! The volume is the integral from -\infty to x_0 + 5 * \sigma_1
 //!  (see email from Oleksiy Burda <burda@ikp.tu-darmstadt.de>, 2008-12-05)
-void EEPeak::StoreIntegral() {
-  // Get fitter
-  TVirtualFitter *fitter = TVirtualFitter::GetFitter();
-  if (fitter == nullptr) {
+void EEPeak::StoreIntegral(const std::vector<std::vector<double>> &covar) {
+  if (covar.empty()) {
     Error("EEPeak::StoreIntegral", "No existing fitter");
     return;
   }
@@ -223,16 +221,16 @@ void EEPeak::StoreIntegral() {
 
   for (int i = 0; i < 5; i++) {
     for (int j = 0; j < 5; j++) {
-      double covar;
+      double c;
 
       // Fixed parameters do not have covariances
       if (id[i] < 0 || id[j] < 0) {
-        covar = 0.0;
+        c = 0.0;
       } else {
-        covar = fitter->GetCovarianceMatrixElement(id[i], id[j]);
+        c = covar[id[i]][id[j]];
       }
 
-      errsq += deriv[i] * deriv[j] * covar;
+      errsq += deriv[i] * deriv[j] * c;
     }
   }
 
@@ -326,6 +324,8 @@ void EEFitter::Fit(TH1 &hist, int intBgDeg) {
 }
 
 void EEFitter::_Fit(TH1 &hist) {
+  FitStats::Timer timer(fStats, "EEFitter");
+
   // Allocate additional parameters for internal polynomial background
   // Note that a polynomial of degree n has n+1 parameters!
   if (fIntBgDeg >= 0) {
@@ -353,13 +353,11 @@ void EEFitter::_Fit(TH1 &hist) {
   }
 
   // Do the fit
-  char options[7];
-  sprintf(options, "RQNM%s%s", fIntegrate.GetValue() ? "I" : "", fLikelihood.GetValue() == "poisson" ? "L" : "");
-  hist.Fit(fSumFunc.get(), options);
+  auto covar = FitHistogram(hist, *fSumFunc, fIntegrate.GetValue(), fLikelihood.GetValue(), fStats);
 
-  // Calculate the peak volumes while the covariance matrix is still available
+  // Calculate the peak volumes from the covariance matrix
   for (auto &peak : fPeaks) {
-    peak.StoreIntegral();
+    peak.StoreIntegral(covar);
   }
 
   // For debugging only
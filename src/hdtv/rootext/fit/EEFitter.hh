@@ -96,7 +96,7 @@ public:
   TF1 *GetPeakFunc();
 
 private:
-  void StoreIntegral();
+  void StoreIntegral(const std::vector<std::vector<double>> &covar);
 
   Param fPos, fAmp, fSigma1, fSigma2, fEta, fGamma;
   double fVol, fVolError;
@@ -29,8 +29,8 @@
 #include <TError.h>
 #include <TF1.h>
 #include <TH1.h>
-#include <TVirtualFitter.h>
 
+#include "Likelihood.hh"
 #include "Util.hh"
 
 namespace HDTV {
@@ -92,6 +92,8 @@ void ExpBg::Fit(TH1 &hist) {
   if (fnParams < 0) { // Degenerate case, no free parameters in fit
     return;
   }
+  FitStats::Timer timer(fStats, "ExpBg");
+
   // Create function to be used for fitting
   // Note that a polynomial of degree N has N+1 parameters
   TF1 fitFunc(GetFuncUniqueName("b_fit", this).c_str(), this, &ExpBg::_EvalRegion, GetMin(), GetMax(), fnParams,
@@ -119,22 +121,19 @@ void ExpBg::Fit(TH1 &hist) {
   }
 
   // Fit
-  char options[7];
-  sprintf(options, "RQNM%s%s", fIntegrate.GetValue() ? "I" : "", fLikelihood.GetValue() == "poisson" ? "L" : "");
-  hist.Fit(&fitFunc, options);
+  auto covar = FitHistogram(hist, fitFunc, fIntegrate.GetValue(), fLikelihood.GetValue(), fStats);
 
   // Copy chisquare
   fChisquare = fitFunc.GetChisquare();
 
   // Copy covariance matrix (needed for error evaluation)
-  TVirtualFitter *fitter = TVirtualFitter::GetFitter();
-  if (fitter == nullptr) {
+  if (covar.empty()) {
     Error("ExpBg::Fit", "No existing fitter after fit");
   } else {
     fCovar = std::vector<std::vector<double>>(fnParams, std::vector<double>(fnParams));
     for (int i = 0; i < fnParams; ++i) {
       for (int j = 0; j < fnParams; ++j) {
-        fCovar[i][j] = fitter->GetCovarianceMatrixElement(i, j);
+        fCovar[i][j] = covar[i][j];
       }
     }
   }
@@ -147,6 +146,8 @@ void ExpBg::Fit(TH1 &hist) {
     fFunc->SetParameter(i, fitFunc.GetParameter(i));
     fFunc->SetParError(i, fitFunc.GetParError(i));
   }
+  fFunc->SetChisquare(fChisquare);
+  fFunc->SetNDF(fitFunc.GetNDF());
 }
 
 bool ExpBg::Restore(const TArrayD &values, const TArrayD &errors, double ChiSquare) {
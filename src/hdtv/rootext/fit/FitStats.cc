@@ -0,0 +1,115 @@
+/*
+ * HDTV - A ROOT-based spectrum analysis software
+ *  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+ *
+ * This file is part of HDTV.
+ *
+ * HDTV is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * HDTV is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HDTV; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ */
+
+#include "FitStats.hh"
+
+#include <cstdio>
+
+#include <map>
+#include <mutex>
+
+namespace HDTV {
+namespace Fit {
+
+namespace {
+
+struct ProfileEntry {
+  int fNumFits = 0;
+  int fNumFailed = 0;
+  long fNumCalls = 0;
+  double fWallTime = 0.0;
+  double fCpuTime = 0.0;
+};
+
+// Fits may run in several threads, e.g. when bootstrapping
+std::mutex gProfileMutex;
+bool gProfileEnabled = false;
+std::map<std::string, ProfileEntry> gProfile;
+
+} // end anonymous namespace
+
+void FitStats::AddMinimization(int ncalls, int status, double edm) {
+  ++fNumMinimizations;
+  fNumCalls += ncalls;
+  fEdm = edm;
+  if (status != 0) {
+    fStatus = status;
+  }
+}
+
+FitStats::Timer::Timer(FitStats &stats, const char *name)
+    : fStats(stats), fName(name), fWallStart(std::chrono::steady_clock::now()), fCpuStart(std::clock()) {
+  fStats.Reset();
+}
+
+FitStats::Timer::~Timer() {
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - fWallStart).count();
+  double cpu = static_cast<double>(std::clock() - fCpuStart) / CLOCKS_PER_SEC;
+  fStats.fWallTime = wall;
+  fStats.fCpuTime = cpu;
+
+  std::lock_guard<std::mutex> lock(gProfileMutex);
+  if (gProfileEnabled) {
+    auto &entry = gProfile[fName];
+    ++entry.fNumFits;
+    if (fStats.fStatus != 0) {
+      ++entry.fNumFailed;
+    }
+    entry.fNumCalls += fStats.fNumCalls;
+    entry.fWallTime += wall;
+    entry.fCpuTime += cpu;
+  }
+}
+
+void FitStats::EnableProfile(bool enable) {
+  std::lock_guard<std::mutex> lock(gProfileMutex);
+  gProfileEnabled = enable;
+}
+
+bool FitStats::IsProfileEnabled() {
+  std::lock_guard<std::mutex> lock(gProfileMutex);
+  return gProfileEnabled;
+}
+
+void FitStats::ResetProfile() {
+  std::lock_guard<std::mutex> lock(gProfileMutex);
+  gProfile.clear();
+}
+
+std::string FitStats::GetProfile() {
+  std::lock_guard<std::mutex> lock(gProfileMutex);
+  char line[160];
+  std::snprintf(line, sizeof(line), "%-20s %8s %8s %12s %12s %12s %12s\n", "fitter", "fits", "failed", "evals",
+                "wall [ms]", "cpu [ms]", "ms/fit");
+  std::string result(line);
+  for (const auto &item : gProfile) {
+    const auto &entry = item.second;
+    std::snprintf(line, sizeof(line), "%-20s %8d %8d %12ld %12.1f %12.1f %12.2f\n", item.first.c_str(),
+                  entry.fNumFits, entry.fNumFailed, entry.fNumCalls, 1e3 * entry.fWallTime, 1e3 * entry.fCpuTime,
+                  1e3 * entry.fWallTime / entry.fNumFits);
+    result += line;
+  }
+  return result;
+}
+
+} // end namespace Fit
+} // end namespace HDTV
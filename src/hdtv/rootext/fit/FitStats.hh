@@ -0,0 +1,94 @@
+/*
+ * HDTV - A ROOT-based spectrum analysis software
+ *  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+ *
+ * This file is part of HDTV.
+ *
+ * HDTV is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * HDTV is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HDTV; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ */
+
+#ifndef __FitStats_h__
+#define __FitStats_h__
+
+#include <chrono>
+#include <ctime>
+#include <string>
+
+namespace HDTV {
+namespace Fit {
+
+//! Evaluation counters and timing of the minimizations done by a fitter
+/**
+ * The numbers add up over all minimizations of one fit (e.g. the variable
+ * projection and the regular fit). Gradients are calculated numerically by
+ * the minimizer, so their evaluations are included in the function
+ * evaluations. CPU time is that of the whole process.
+ *
+ * If enabled, all fits are also added up in a profile for the whole session,
+ * grouped by the kind of fitter.
+ */
+class FitStats {
+public:
+  void Reset() { *this = FitStats(); }
+
+  int GetNumMinimizations() const { return fNumMinimizations; }
+  int GetNumCalls() const { return fNumCalls; }
+  int GetStatus() const { return fStatus; }
+  double GetEdm() const { return fEdm; }
+  double GetWallTime() const { return fWallTime; }
+  double GetCpuTime() const { return fCpuTime; }
+
+  //! Record one minimization; the status is the one of the last
+  //! unsuccessful minimization, or 0
+  void AddMinimization(int ncalls, int status, double edm);
+
+  //! Covers one fit: resets the stats on construction, and on destruction
+  //! stores the elapsed time (and adds the fit to the profile under the given
+  //! name, if enabled)
+  class Timer {
+  public:
+    Timer(FitStats &stats, const char *name);
+    ~Timer();
+
+    Timer(const Timer &) = delete;
+    Timer &operator=(const Timer &) = delete;
+
+  private:
+    FitStats &fStats;
+    const char *fName;
+    std::chrono::steady_clock::time_point fWallStart;
+    std::clock_t fCpuStart;
+  };
+
+  static void EnableProfile(bool enable);
+  static bool IsProfileEnabled();
+  static void ResetProfile();
+  //! Profile of the session as a table
+  static std::string GetProfile();
+
+private:
+  int fNumMinimizations = 0;
+  int fNumCalls = 0;
+  int fStatus = 0;
+  double fEdm = 0.0;
+  double fWallTime = 0.0; // seconds
+  double fCpuTime = 0.0;  // seconds
+};
+
+} // end namespace Fit
+} // end namespace HDTV
+
+#endif
@@ -27,6 +27,7 @@
 #include <memory>
 
 #include "Background.hh"
+#include "FitStats.hh"
 #include "Param.hh"
 
 namespace HDTV {
@@ -46,6 +47,7 @@ public:
 
   int GetIntNParams() const { return fIntNParams; }
   double GetChisquare() const { return fChisquare; }
+  const FitStats &GetFitStats() const { return fStats; }
 
 protected:
   int fNumParams;
@@ -59,6 +61,7 @@ protected:
   std::unique_ptr<TF1> fSumFunc;
   std::unique_ptr<TF1> fBgFunc;
   double fChisquare;
+  FitStats fStats;
 
   void SetParameter(TF1 &func, Param &param, double ival = 0.0, bool useLimits = false,
                     double lowerLimit = std::numeric_limits<double>::min(),
@@ -94,6 +94,7 @@ InterpolationBg &InterpolationBg::operator=(const InterpolationBg &src) {
 }
 
 void InterpolationBg::Fit(TH1 &hist) {
+  FitStats::Timer timer(fStats, "InterpolationBg");
 
   // Need to cast background region centers and mean values into
   // std::vector or array to be able to call ROOT::Math:Interpolator.
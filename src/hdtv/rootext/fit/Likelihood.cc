@@ -0,0 +1,221 @@
+/*
+ * HDTV - A ROOT-based spectrum analysis software
+ *  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+ *
+ * This file is part of HDTV.
+ *
+ * HDTV is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * HDTV is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HDTV; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ */
+
+#include "Likelihood.hh"
+
+#include <cmath>
+#include <cstdio>
+
+#include <algorithm>
+#include <limits>
+
+#include <Fit/Fitter.h>
+#include <Math/Functor.h>
+#include <TError.h>
+#include <TF1.h>
+#include <TFitResult.h>
+#include <TFitResultPtr.h>
+#include <TH1.h>
+
+#include "FitStats.hh"
+#include "Util.hh"
+
+namespace HDTV {
+namespace Fit {
+
+BinnedObjective::BinnedObjective(const TH1 &hist, TF1 &func, bool integrate, bool skipEmpty)
+    : fFunc(func), fNodes(integrate ? cGaussLegendreOrder : 1) {
+  double min, max;
+  func.GetRange(min, max);
+
+  // As in TH1::Fit, the function may reject points (e.g. outside the regions
+  // of a background fit) when it is evaluated there
+  auto rejected = [&func](double x) {
+    TF1::RejectPoint(false);
+    func.Eval(x);
+    return TF1::RejectedPoint();
+  };
+
+  // As in TH1::Fit with the "R" option, use all bins with the center inside
+  // the range of the function. With integration, a bin is only used if none
+  // of its nodes is rejected.
+  for (int b = 1; b <= hist.GetNbinsX(); ++b) {
+    double center = hist.GetBinCenter(b);
+    double error = hist.GetBinError(b);
+    if (center < min || center > max || (skipEmpty && error <= 0.0) || rejected(center)) {
+      continue;
+    }
+    if (integrate) {
+      double halfWidth = hist.GetBinWidth(b) / 2.0;
+      bool skip = false;
+      for (int k = 0; k < fNodes && !skip; ++k) {
+        skip = rejected(center + halfWidth * cGaussLegendreNodes[k]);
+      }
+      if (skip) {
+        continue;
+      }
+      for (int k = 0; k < fNodes; ++k) {
+        fX.push_back(center + halfWidth * cGaussLegendreNodes[k]);
+        fWeights.push_back(cGaussLegendreWeights[k] / 2.0);
+      }
+    } else {
+      fX.push_back(center);
+      fWeights.push_back(1.0);
+    }
+    fContent.push_back(hist.GetBinContent(b));
+    fError.push_back(error);
+  }
+  TF1::RejectPoint(false);
+}
+
+double BinnedObjective::Model(std::size_t bin, const double *p) const {
+  double f = 0.0;
+  for (std::size_t i = bin * fNodes; i < (bin + 1) * fNodes; ++i) {
+    f += fWeights[i] * fFunc.EvalPar(&fX[i], p);
+  }
+  return f;
+}
+
+void CopyParamSettings(ROOT::Fit::ParameterSettings &settings, const TF1 &func, int id) {
+  double value = func.GetParameter(id);
+  double error = func.GetParError(id);
+  settings.SetValue(value);
+  settings.SetStepSize(error > 0.0 ? error : (value != 0.0 ? 0.3 * std::abs(value) : 0.3));
+
+  // Same conventions for fixed and limited parameters as in TF1
+  double lower, upper;
+  func.GetParLimits(id, lower, upper);
+  if (lower * upper != 0.0 && lower >= upper) {
+    settings.Fix();
+  } else if (lower < upper) {
+    settings.SetLimits(lower, upper);
+  }
+}
+
+std::vector<std::vector<double>> BinnedObjective::Fit(FitStats &stats) {
+  int npar = fFunc.GetNpar();
+
+  ROOT::Fit::Fitter fitter;
+  fitter.Config().SetParamsSettings(npar, fFunc.GetParameters());
+  fitter.Config().SetParabErrors(true);
+  for (int i = 0; i < npar; ++i) {
+    CopyParamSettings(fitter.Config().ParSettings(i), fFunc, i);
+  }
+
+  // Passing no parameter values keeps the settings made above
+  ROOT::Math::Functor fcn([this](const double *p) { return (*this)(p); }, npar);
+  fitter.FitFCN(fcn, nullptr, fContent.size(), true);
+
+  // Like TH1::Fit, keep the result even if the minimizer did not converge
+  const auto &result = fitter.Result();
+  stats.AddMinimization(result.NCalls(), result.Status(), result.Edm());
+  if (result.Parameters().empty()) {
+    return {};
+  }
+  fFunc.SetParameters(result.GetParams());
+  fFunc.SetParErrors(result.GetErrors());
+  fFunc.SetChisquare(result.MinFcnValue());
+  fFunc.SetNDF(result.Ndf());
+  fFunc.SetNumberFitPoints(fContent.size());
+
+  std::vector<std::vector<double>> covar(npar, std::vector<double>(npar));
+  for (int i = 0; i < npar; ++i) {
+    for (int j = 0; j < npar; ++j) {
+      covar[i][j] = result.CovMatrix(i, j);
+    }
+  }
+  return covar;
+}
+
+ChiSquare::ChiSquare(const TH1 &hist, TF1 &func, bool integrate) : BinnedObjective(hist, func, integrate, true) {}
+
+double ChiSquare::operator()(const double *p) const {
+  double sum = 0.0;
+  for (std::size_t i = 0; i < fContent.size(); ++i) {
+    double r = (fContent[i] - Model(i, p)) / fError[i];
+    sum += r * r;
+  }
+  return sum;
+}
+
+// Empty bins do contribute to the likelihood
+PoissonLikelihood::PoissonLikelihood(const TH1 &hist, TF1 &func, bool integrate)
+    : BinnedObjective(hist, func, integrate, false), fDataTerm(0.0) {
+  for (double n : fContent) {
+    if (n > 0.0) {
+      fDataTerm += n * std::log(n) - n;
+    }
+  }
+}
+
+double PoissonLikelihood::operator()(const double *p) const {
+  double sum = fDataTerm;
+  for (std::size_t i = 0; i < fContent.size(); ++i) {
+    // The model must be positive wherever there are counts
+    double f = std::max(Model(i, p), std::numeric_limits<double>::min());
+    sum += f;
+    if (fContent[i] > 0.0) {
+      sum -= fContent[i] * std::log(f);
+    }
+  }
+  return 2.0 * sum;
+}
+
+std::unique_ptr<BinnedObjective> MakeObjective(const TH1 &hist, TF1 &func, bool integrate,
+                                               const std::string &likelihood) {
+  if (likelihood == "poisson") {
+    return std::make_unique<PoissonLikelihood>(hist, func, integrate);
+  }
+  return std::make_unique<ChiSquare>(hist, func, integrate);
+}
+
+std::vector<std::vector<double>> FitHistogram(TH1 &hist, TF1 &func, bool integrate, const std::string &likelihood,
+                                              FitStats &stats) {
+  if (likelihood == "poisson") {
+    PoissonLikelihood fcn(hist, func, integrate);
+    return fcn.Fit(stats);
+  }
+
+  // The "S" option returns the fit result, which holds the covariance matrix.
+  // TVirtualFitter is not used: with thread safety enabled, TH1::Fit no
+  // longer updates it.
+  char options[8];
+  sprintf(options, "RQNMS%s", integrate ? "I" : "");
+  TFitResultPtr fitResult = hist.Fit(&func, options);
+  if (fitResult.Get() == nullptr) {
+    // Without a result, the pointer only holds the status of the failed fit
+    stats.AddMinimization(0, fitResult, 0.0);
+    return {};
+  }
+  stats.AddMinimization(fitResult->NCalls(), fitResult->Status(), fitResult->Edm());
+  int npar = func.GetNpar();
+  std::vector<std::vector<double>> covar(npar, std::vector<double>(npar));
+  for (int i = 0; i < npar; ++i) {
+    for (int j = 0; j < npar; ++j) {
+      covar[i][j] = fitResult->CovMatrix(i, j);
+    }
+  }
+  return covar;
+}
+
+} // end namespace Fit
+} // end namespace HDTV
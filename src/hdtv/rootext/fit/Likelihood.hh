@@ -0,0 +1,123 @@
+/*
+ * HDTV - A ROOT-based spectrum analysis software
+ *  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+ *
+ * This file is part of HDTV.
+ *
+ * HDTV is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * HDTV is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HDTV; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ */
+
+#ifndef __Likelihood_h__
+#define __Likelihood_h__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class TF1;
+class TH1;
+
+namespace ROOT {
+namespace Fit {
+class ParameterSettings;
+} // end namespace Fit
+} // end namespace ROOT
+
+namespace HDTV {
+namespace Fit {
+
+class FitStats;
+
+//! Goodness-of-fit statistic of a function to the bins of a histogram
+/**
+ * The bins within the range of the function, except those where it rejects
+ * the point (see TF1::RejectPoint()), are copied into contiguous arrays once,
+ * so each evaluation only has to walk the model values. With integration, the
+ * function is averaged over each bin by Gauss-Legendre quadrature; otherwise,
+ * it is evaluated at the bin center. Like a chi^2, the minimum value is a
+ * goodness-of-fit measure, and errors correspond to an increase of 1.
+ */
+class BinnedObjective {
+public:
+  virtual ~BinnedObjective() = default;
+
+  virtual double operator()(const double *p) const = 0;
+
+  int GetNPoints() const { return fContent.size(); }
+  TF1 &GetFunc() const { return fFunc; }
+
+  //! Minimize, starting from (and storing the result in) the parameters of
+  //! the function. Returns the covariance matrix of all parameters, which is
+  //! empty if the fit failed. The minimization is recorded in stats.
+  std::vector<std::vector<double>> Fit(FitStats &stats);
+
+protected:
+  //! If skipEmpty is set, bins with zero error are left out
+  BinnedObjective(const TH1 &hist, TF1 &func, bool integrate, bool skipEmpty);
+
+  double Model(std::size_t bin, const double *p) const;
+
+  TF1 &fFunc;
+  int fNodes;                   // evaluation points per bin
+  std::vector<double> fX;       // evaluation points
+  std::vector<double> fWeights; // quadrature weights
+  std::vector<double> fContent, fError;
+};
+
+//! Weighted least squares chi^2, skipping bins without error like TH1::Fit
+class ChiSquare : public BinnedObjective {
+public:
+  ChiSquare(const TH1 &hist, TF1 &func, bool integrate);
+
+  double operator()(const double *p) const override;
+};
+
+//! Baker-Cousins Poisson likelihood chi^2
+/**
+ * chi^2 = 2 sum_i [f_i - n_i + n_i ln(n_i / f_i)], see
+ * S. Baker and R. D. Cousins, Nucl. Instrum. Meth. 221 (1984) 437.
+ * The terms that depend only on the data are summed up in advance.
+ */
+class PoissonLikelihood : public BinnedObjective {
+public:
+  PoissonLikelihood(const TH1 &hist, TF1 &func, bool integrate);
+
+  double operator()(const double *p) const override;
+
+private:
+  double fDataTerm; // sum_i n_i ln(n_i) - n_i
+};
+
+//! Create the objective matching the likelihood option ("normal" or "poisson")
+std::unique_ptr<BinnedObjective> MakeObjective(const TH1 &hist, TF1 &func, bool integrate,
+                                               const std::string &likelihood);
+
+//! Copy start value, step size, limits and fixing of parameter id of func to
+//! the settings of a ROOT::Fit parameter
+void CopyParamSettings(ROOT::Fit::ParameterSettings &settings, const TF1 &func, int id);
+
+//! Fit func to the bins of hist within the range of func, minimizing either
+//! chi^2 (likelihood = "normal", through TH1::Fit) or the PoissonLikelihood
+//! (likelihood = "poisson"). Parameters, errors and chi^2 are stored in func.
+//! Returns the covariance matrix of all parameters, which is empty if it is
+//! not available. The minimization is recorded in stats, also if it failed.
+std::vector<std::vector<double>> FitHistogram(TH1 &hist, TF1 &func, bool integrate, const std::string &likelihood,
+                                              FitStats &stats);
+
+} // end namespace Fit
+} // end namespace HDTV
+
+#endif
@@ -20,9 +20,16 @@
 #pragma link C++ class HDTV::Fit::Param+;
 #pragma link C++ class HDTV::Fit::Option<bool>+;
 #pragma link C++ class HDTV::Fit::Option<std::string>+;
+#pragma link C++ class HDTV::Fit::FitStats+;
 #pragma link C++ class HDTV::Fit::Fitter+;
+#pragma link C++ class HDTV::Fit::WidthModel+;
 #pragma link C++ class HDTV::Fit::TheuerkaufPeak+;
 #pragma link C++ class HDTV::Fit::TheuerkaufFitter+;
+#pragma link C++ class HDTV::Fit::MultiFitter+;
+#pragma link C++ class HDTV::Fit::Bootstrap+;
+#pragma link C++ class HDTV::Fit::PeakCandidate+;
+#pragma link C++ class HDTV::Fit::PeakGroup+;
+#pragma link C++ class HDTV::Fit::PeakFinder+;
 #pragma link C++ class HDTV::Fit::EEPeak+;
 #pragma link C++ class HDTV::Fit::EEFitter+;
 
@@ -0,0 +1,377 @@
+/*
+ * HDTV - A ROOT-based spectrum analysis software
+ *  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+ *
+ * This file is part of HDTV.
+ *
+ * HDTV is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * HDTV is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HDTV; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ */
+
+#include "MultiFitter.hh"
+
+#include <cmath>
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+#include <Fit/Fitter.h>
+#include <Math/Functor.h>
+#include <TError.h>
+#include <TF1.h>
+#include <TH1.h>
+
+#include "Likelihood.hh"
+#include "TheuerkaufFitter.hh"
+
+namespace HDTV {
+namespace Fit {
+
+struct MultiFitter::Spectrum {
+  TheuerkaufFitter *fFitter;
+  std::unique_ptr<BinnedObjective> fObjective;
+  std::vector<int> fGlobalId;          // global parameter index of each local parameter
+  std::vector<int> fOffsetId;          // global index of the offset added to each local parameter, or -1
+  mutable std::vector<double> fParams; // local parameters, only touched by one thread at a time
+};
+
+//! Below this number of bins in all spectra, they are evaluated in a single
+//! thread, as waking up the others would take longer
+static const int cMinParallelPoints = 1000;
+
+//! Threads evaluating the spectra in parallel. They are kept for a whole
+//! Fit() and wait for the next evaluation in between.
+struct MultiFitter::Pool {
+  using Job = std::function<void(std::size_t, std::size_t)>;
+
+  explicit Pool(std::size_t nThreads);
+  ~Pool();
+
+  //! Call job(t, nThreads) in each thread t, with t = 0 being the calling
+  //! thread, and wait for all of them to finish
+  void Run(const Job &job);
+
+  std::size_t fNumThreads;
+  std::vector<std::thread> fThreads;
+  std::mutex fMutex;
+  std::condition_variable fStart;
+  std::condition_variable fDone;
+  const Job *fJob = nullptr;
+  unsigned long fGeneration = 0; // counts the jobs started
+  std::size_t fPending = 0;      // threads still running the current job
+  bool fStop = false;
+};
+
+MultiFitter::Pool::Pool(std::size_t nThreads) : fNumThreads(nThreads) {
+  for (std::size_t t = 1; t < nThreads; ++t) {
+    fThreads.emplace_back([this, t]() {
+      unsigned long generation = 0;
+      std::unique_lock<std::mutex> lock(fMutex);
+      while (true) {
+        fStart.wait(lock, [&]() { return fStop || fGeneration != generation; });
+        if (fStop) {
+          return;
+        }
+        generation = fGeneration;
+        const Job &job = *fJob;
+        lock.unlock();
+        job(t, fNumThreads);
+        lock.lock();
+        if (--fPending == 0) {
+          fDone.notify_one();
+        }
+      }
+    });
+  }
+}
+
+MultiFitter::Pool::~Pool() {
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStop = true;
+  }
+  fStart.notify_all();
+  for (auto &thread : fThreads) {
+    thread.join();
+  }
+}
+
+void MultiFitter::Pool::Run(const Job &job) {
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fJob = &job;
+    fPending = fThreads.size();
+    ++fGeneration;
+  }
+  fStart.notify_all();
+  job(0, fNumThreads);
+
+  std::unique_lock<std::mutex> lock(fMutex);
+  fDone.wait(lock, [this]() { return fPending == 0; });
+}
+
+MultiFitter::MultiFitter(Option<bool> integrate, Option<std::string> likelihood)
+    : fIntegrate(integrate), fLikelihood(likelihood), fPool(nullptr), fNumParams(0),
+      fChisquare(std::numeric_limits<double>::quiet_NaN()), fStatus(-1) {}
+
+MultiFitter::~MultiFitter() = default;
+
+bool MultiFitter::AddSpectrum(TheuerkaufFitter &fitter, TH1 &hist, const Background &bg) {
+  if (fitter.IsFinal()) {
+    return false;
+  }
+
+  fitter.fBackground.reset(bg.Clone());
+  fitter.fIntNParams = 0;
+  return _AddSpectrum(fitter, hist);
+}
+
+bool MultiFitter::AddSpectrum(TheuerkaufFitter &fitter, TH1 &hist, int intNParams) {
+  if (fitter.IsFinal()) {
+    return false;
+  }
+
+  fitter.fBackground.reset();
+  fitter.fIntNParams = intNParams;
+  return _AddSpectrum(fitter, hist);
+}
+
+//! Private: estimate initial parameters and copy the data of the fit region
+bool MultiFitter::_AddSpectrum(TheuerkaufFitter &fitter, TH1 &hist) {
+  fitter._Init(hist);
+
+  auto spectrum = std::make_unique<Spectrum>();
+  spectrum->fFitter = &fitter;
+  spectrum->fObjective = MakeObjective(hist, *fitter.fSumFunc, fIntegrate.GetValue(), fLikelihood.GetValue());
+  spectrum->fParams.resize(fitter.fNumParams);
+  fSpectra.push_back(std::move(spectrum));
+
+  return true;
+}
+
+bool MultiFitter::Share(const std::string &name) {
+  static const std::set<std::string> names{"pos", "offset", "width", "tl", "tr", "sh", "sw"};
+  if (names.count(name) == 0) {
+    Warning("HDTV::MultiFitter::Share", "unknown parameter %s", name.c_str());
+    return false;
+  }
+
+  fShared.insert(name);
+  return true;
+}
+
+//! Private: assign global parameter indices. Shared parameters of the i-th peak
+//! (and shared width model coefficients) are mapped to the same index as in
+//! the first spectrum; all others get their own. Shared positions of the
+//! other spectra are shifted by an offset, one for each spectrum, if "offset"
+//! is shared.
+void MultiFitter::MapParams() {
+  fNumParams = 0;
+  for (auto &spectrum : fSpectra) {
+    spectrum->fGlobalId.assign(spectrum->fFitter->fNumParams, -1);
+    spectrum->fOffsetId.assign(spectrum->fFitter->fNumParams, -1);
+  }
+
+  const Spectrum &ref = *fSpectra.front();
+  const auto &refPeaks = ref.fFitter->fPeaks;
+  bool withOffset = fShared.count("offset") != 0;
+  for (auto &spectrum : fSpectra) {
+    auto share = [&](const Param &param, const Param &refParam, int offsetId) {
+      if (!param || !refParam || !param.IsFree() || !refParam.IsFree()) {
+        return false;
+      }
+      spectrum->fGlobalId[param._Id()] = ref.fGlobalId[refParam._Id()];
+      spectrum->fOffsetId[param._Id()] = offsetId;
+      return true;
+    };
+
+    const auto &peaks = spectrum->fFitter->fPeaks;
+    if (spectrum != fSpectra.front() && peaks.size() == refPeaks.size()) {
+      for (const auto &name : fShared) {
+        if (name == "offset" || (name == "pos" && withOffset)) {
+          continue;
+        }
+        for (std::size_t i = 0; i < peaks.size(); ++i) {
+          share(*peaks[i].GetParam(name), *refPeaks[i].GetParam(name), -1);
+        }
+      }
+      if (withOffset) {
+        bool shifted = false;
+        for (std::size_t i = 0; i < peaks.size(); ++i) {
+          shifted |= share(peaks[i].fPos, refPeaks[i].fPos, fNumParams);
+        }
+        if (shifted) {
+          ++fNumParams;
+        }
+      }
+    } else if (!fShared.empty() && peaks.size() != refPeaks.size()) {
+      Warning("HDTV::MultiFitter::Fit", "number of peaks differs between spectra; peak parameters are not shared");
+    }
+
+    // The width model does not depend on the peaks
+    if (spectrum != fSpectra.front() && fShared.count("width") != 0) {
+      for (int k = 0; k < 3; ++k) {
+        share(spectrum->fFitter->fWidthModel.GetCoeff(k), ref.fFitter->fWidthModel.GetCoeff(k), -1);
+      }
+    }
+
+    for (auto &id : spectrum->fGlobalId) {
+      if (id < 0) {
+        id = fNumParams++;
+      }
+    }
+  }
+}
+
+double MultiFitter::Eval(const double *q) const {
+  std::vector<double> chi2(fSpectra.size());
+  Pool::Job evalSpectra = [&](std::size_t first, std::size_t step) {
+    for (std::size_t s = first; s < fSpectra.size(); s += step) {
+      const auto &spectrum = *fSpectra[s];
+      for (std::size_t i = 0; i < spectrum.fParams.size(); ++i) {
+        int offsetId = spectrum.fOffsetId[i];
+        spectrum.fParams[i] = q[spectrum.fGlobalId[i]] + (offsetId < 0 ? 0.0 : q[offsetId]);
+      }
+      chi2[s] = (*spectrum.fObjective)(spectrum.fParams.data());
+    }
+  };
+
+  if (fPool) {
+    fPool->Run(evalSpectra);
+  } else {
+    evalSpectra(0, 1);
+  }
+
+  return std::accumulate(chi2.begin(), chi2.end(), 0.0);
+}
+
+void MultiFitter::Fit() {
+  if (fSpectra.empty()) {
+    return;
+  }
+
+  FitStats::Timer timer(fStats, "MultiFitter");
+  MapParams();
+
+  ROOT::Fit::Fitter fitter;
+  std::vector<double> start(fNumParams, 0.0);
+  std::vector<double> first(fNumParams, 0.0); // start value in the first spectrum using the parameter
+  std::vector<int> count(fNumParams, 0);
+  fitter.Config().SetParamsSettings(fNumParams, start.data());
+  fitter.Config().SetParabErrors(true);
+  for (auto &spectrum : fSpectra) {
+    TF1 &func = *spectrum->fFitter->fSumFunc;
+
+    // An offset starts at the mean distance of the shifted positions to
+    // those of the first spectrum
+    int offsetId = -1;
+    double offset = 0.0;
+    int nShifted = 0;
+    for (std::size_t i = 0; i < spectrum->fOffsetId.size(); ++i) {
+      if (spectrum->fOffsetId[i] >= 0) {
+        offsetId = spectrum->fOffsetId[i];
+        offset += func.GetParameter(i) - first[spectrum->fGlobalId[i]];
+        ++nShifted;
+      }
+    }
+    if (offsetId >= 0) {
+      offset /= nShifted;
+      start[offsetId] = offset;
+      count[offsetId] = 1;
+      fitter.Config().ParSettings(offsetId).SetStepSize(0.1);
+    }
+
+    for (std::size_t i = 0; i < spectrum->fGlobalId.size(); ++i) {
+      int id = spectrum->fGlobalId[i];
+      double value = func.GetParameter(i) - (spectrum->fOffsetId[i] < 0 ? 0.0 : offset);
+      if (count[id]++ == 0) {
+        CopyParamSettings(fitter.Config().ParSettings(id), func, i);
+        first[id] = value;
+      }
+      start[id] += value;
+    }
+  }
+  for (int id = 0; id < fNumParams; ++id) {
+    fitter.Config().ParSettings(id).SetValue(start[id] / count[id]);
+  }
+
+  int nPoints = std::accumulate(fSpectra.begin(), fSpectra.end(), 0,
+                                [](int sum, const auto &spectrum) { return sum + spectrum->fObjective->GetNPoints(); });
+  std::unique_ptr<Pool> pool;
+  std::size_t nThreads = std::min<std::size_t>(fSpectra.size(), std::max(1u, std::thread::hardware_concurrency()));
+  if (nThreads > 1 && nPoints >= cMinParallelPoints) {
+    pool = std::make_unique<Pool>(nThreads);
+  }
+  fPool = pool.get();
+  ROOT::Math::Functor fcn([this](const double *q) { return Eval(q); }, fNumParams);
+  fitter.FitFCN(fcn, nullptr, nPoints, true);
+  fPool = nullptr;
+  pool.reset();
+
+  const auto &result = fitter.Result();
+  fStatus = result.Status();
+  fStats.AddMinimization(result.NCalls(), result.Status(), result.Edm());
+  if (result.Parameters().empty()) {
+    return;
+  }
+  fChisquare = result.MinFcnValue();
+
+  // Hand the results to the individual fitters. A shifted parameter is the
+  // sum of two global ones, so its covariances are the sums of theirs.
+  for (auto &spectrum : fSpectra) {
+    TheuerkaufFitter &sub = *spectrum->fFitter;
+    TF1 &func = *sub.fSumFunc;
+    auto covar = [&](std::size_t i, std::size_t j) {
+      double c = 0.0;
+      for (int a : {spectrum->fGlobalId[i], spectrum->fOffsetId[i]}) {
+        for (int b : {spectrum->fGlobalId[j], spectrum->fOffsetId[j]}) {
+          if (a >= 0 && b >= 0) {
+            c += result.CovMatrix(a, b);
+          }
+        }
+      }
+      return c;
+    };
+
+    for (std::size_t i = 0; i < spectrum->fGlobalId.size(); ++i) {
+      int id = spectrum->fGlobalId[i];
+      int offsetId = spectrum->fOffsetId[i];
+      double value = result.Parameter(id) + (offsetId < 0 ? 0.0 : result.Parameter(offsetId));
+      spectrum->fParams[i] = value;
+      func.SetParameter(i, value);
+      func.SetParError(i, offsetId < 0 ? result.ParError(id) : std::sqrt(std::max(covar(i, i), 0.0)));
+    }
+    if (sub.fWidthModel) {
+      std::size_t npar = spectrum->fGlobalId.size();
+      sub.fWidthModel.fCovar.assign(npar, std::vector<double>(npar));
+      for (std::size_t i = 0; i < npar; ++i) {
+        for (std::size_t j = 0; j < npar; ++j) {
+          sub.fWidthModel.fCovar[i][j] = covar(i, j);
+        }
+      }
+    }
+    sub.fChisquare = (*spectrum->fObjective)(spectrum->fParams.data());
+    func.SetChisquare(sub.fChisquare);
+    sub.fFinal = true;
+  }
+}
+
+} // end namespace Fit
+} // end namespace HDTV
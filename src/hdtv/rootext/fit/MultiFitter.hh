@@ -0,0 +1,108 @@
+/*
+ * HDTV - A ROOT-based spectrum analysis software
+ *  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+ *
+ * This file is part of HDTV.
+ *
+ * HDTV is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * HDTV is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HDTV; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ */
+
+#ifndef __MultiFitter_h__
+#define __MultiFitter_h__
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "FitStats.hh"
+#include "Option.hh"
+
+class TH1;
+
+namespace HDTV {
+namespace Fit {
+
+class Background;
+class BinnedObjective;
+class TheuerkaufFitter;
+
+//! Simultaneous fit of the same peaks in several spectra
+/**
+ * Each spectrum is described by its own TheuerkaufFitter, set up with its
+ * peaks as usual. Parameters of a given kind (e.g. the widths) can be shared,
+ * so that the parameter of the i-th peak is the same in all spectra. All
+ * spectra are then fitted at once, minimizing the sum of their chi^2 (or
+ * Poisson likelihood chi^2), with the spectra evaluated in parallel if there
+ * are enough bins to make up for the synchronization. After
+ * the fit, each TheuerkaufFitter holds the results for its spectrum, as if
+ * it had been fitted on its own.
+ */
+class MultiFitter {
+public:
+  MultiFitter(Option<bool> integrate, Option<std::string> likelihood);
+  ~MultiFitter();
+
+  // Copying the fitter is not supported
+  MultiFitter(const MultiFitter &) = delete;
+  MultiFitter &operator=(const MultiFitter &) = delete;
+
+  //! Add a spectrum. The fitter must have its peaks, and must not have been
+  //! fitted yet; both it and hist must outlive the MultiFitter. Background
+  //! as in TheuerkaufFitter::Fit().
+  bool AddSpectrum(TheuerkaufFitter &fitter, TH1 &hist, const Background &bg);
+  bool AddSpectrum(TheuerkaufFitter &fitter, TH1 &hist, int intNParams = -1);
+
+  //! Share a peak parameter ("pos", "width", "tl", "tr", "sh" or "sw") among
+  //! all spectra. The spectra must have the same number of peaks, and only
+  //! parameters that are free in both spectra are shared. "width" also shares
+  //! the free coefficients of the width models, for fitters that have one.
+  //! "offset" shares the positions up to one offset per spectrum (relative to
+  //! the first one), which is fitted as well, e.g. for slightly different
+  //! calibrations.
+  bool Share(const std::string &name);
+
+  void Fit();
+
+  int GetNumSpectra() const { return fSpectra.size(); }
+  int GetNumParams() const { return fNumParams; }
+  double GetChisquare() const { return fChisquare; }
+  int GetStatus() const { return fStatus; }
+  const FitStats &GetFitStats() const { return fStats; }
+
+private:
+  struct Spectrum;
+  struct Pool;
+
+  bool _AddSpectrum(TheuerkaufFitter &fitter, TH1 &hist);
+  void MapParams();
+  double Eval(const double *q) const;
+
+  Option<bool> fIntegrate;
+  Option<std::string> fLikelihood;
+  std::vector<std::unique_ptr<Spectrum>> fSpectra; //!
+  Pool *fPool;                                     //! threads evaluating the spectra during Fit(), if any
+  std::set<std::string> fShared;
+  int fNumParams;
+  double fChisquare;
+  int fStatus;
+  FitStats fStats;
+};
+
+} // end namespace Fit
+} // end namespace HDTV
+
+#endif
@@ -0,0 +1,196 @@
+/*
+ * HDTV - A ROOT-based spectrum analysis software
+ *  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+ *
+ * This file is part of HDTV.
+ *
+ * HDTV is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * HDTV is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HDTV; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ */
+
+#include "PeakFinder.hh"
+
+#include <cmath>
+
+#include <algorithm>
+
+#include <TAxis.h>
+#include <TError.h>
+#include <TH1.h>
+
+namespace HDTV {
+namespace Fit {
+
+// Distance of peaks in a group, and margin of the fit region beyond the
+// outermost peaks, in units of sigma
+static const double cGroupDistance = 5.0;
+static const double cRegionMargin = 2.5;
+
+// Half widths of the SNIP clipping window and of the filter, in units of sigma
+static const double cSnipWidth = 4.0;
+static const double cFilterWidth = 3.0;
+
+//! Private: expected sigma of a peak at x, in channels
+double PeakFinder::SigmaAt(double x) const {
+  if (!fCal) {
+    return fSigma;
+  }
+  return fSigma / std::abs(fCal.dEdCh(x));
+}
+
+int PeakFinder::Search(const TH1 &hist, double min, double max) {
+  fPeaks.clear();
+  fGroups.clear();
+
+  if (!(fSigma > 0.0)) {
+    Warning("HDTV::Fit::PeakFinder::Search", "sigma must be positive");
+    return 0;
+  }
+
+  const TAxis *axis = hist.GetXaxis();
+  int nBins = hist.GetNbinsX();
+  int b1 = std::max(axis->FindFixBin(std::min(min, max)), 1);
+  int b2 = std::min(axis->FindFixBin(std::max(min, max)), nBins);
+  if (b2 < b1) {
+    return 0;
+  }
+
+  // Expected sigma in bins. Outside of the search region, the bins are used
+  // by the background estimation and the filter only.
+  auto sigmaBins = [&](int b) { return SigmaAt(axis->GetBinCenter(b)) / axis->GetBinWidth(b); };
+  int margin = static_cast<int>(std::ceil(std::max(cSnipWidth, cFilterWidth) *
+                                          std::max(sigmaBins(b1), sigmaBins(b2)))) + 1;
+  int lo = std::max(b1 - margin, 1);
+  int hi = std::min(b2 + margin, nBins);
+  int n = hi - lo + 1;
+
+  std::vector<double> counts(n), sigma(n);
+  for (int i = 0; i < n; ++i) {
+    counts[i] = hist.GetBinContent(lo + i);
+    sigma[i] = sigmaBins(lo + i);
+  }
+
+  // Background: SNIP, with clipping windows growing up to cSnipWidth sigma
+  std::vector<double> bg(n), clipped(n);
+  int maxWindow = 0;
+  std::vector<int> window(n);
+  for (int i = 0; i < n; ++i) {
+    bg[i] = std::log(std::log(std::sqrt(std::max(counts[i], 0.0) + 1.0) + 1.0) + 1.0);
+    window[i] = static_cast<int>(std::ceil(cSnipWidth * sigma[i]));
+    maxWindow = std::max(maxWindow, window[i]);
+  }
+  for (int p = 1; p <= maxWindow; ++p) {
+    for (int i = p; i < n - p; ++i) {
+      clipped[i] = p <= window[i] ? std::min(bg[i], (bg[i - p] + bg[i + p]) / 2.0) : bg[i];
+    }
+    std::copy(clipped.begin() + p, clipped.end() - p, bg.begin() + p);
+  }
+  for (auto &b : bg) {
+    b = std::pow(std::exp(std::exp(b) - 1.0) - 1.0, 2) - 1.0;
+  }
+
+  // Filter response and its significance. The kernel is made to sum up to
+  // zero, so that a linear background left over does not contribute. It is
+  // only recalculated when the expected width has changed by more than 1%.
+  std::vector<double> response(n, 0.0), significance(n, 0.0), gain(n, 0.0);
+  std::vector<double> kernel;
+  double kernelSigma = 0.0;
+  double kernelGain = 0.0;
+  int half = 0;
+  for (int i = b1 - lo; i <= b2 - lo; ++i) {
+    if (std::abs(sigma[i] - kernelSigma) > 0.01 * kernelSigma) {
+      kernelSigma = sigma[i];
+      half = static_cast<int>(std::ceil(cFilterWidth * kernelSigma));
+      kernel.resize(2 * half + 1);
+      double mean = 0.0;
+      for (int k = -half; k <= half; ++k) {
+        double u = k / kernelSigma;
+        kernel[k + half] = (1.0 - u * u) * std::exp(-u * u / 2.0);
+        mean += kernel[k + half] / kernel.size();
+      }
+      // Response to a gaussian of unit amplitude at the center
+      kernelGain = 0.0;
+      for (int k = -half; k <= half; ++k) {
+        kernel[k + half] -= mean;
+        kernelGain += kernel[k + half] * std::exp(-std::pow(k / kernelSigma, 2) / 2.0);
+      }
+    }
+
+    double sum = 0.0, var = 0.0;
+    for (int k = std::max(-half, -i); k <= std::min(half, n - 1 - i); ++k) {
+      double error = hist.GetBinError(lo + i + k);
+      sum += kernel[k + half] * (counts[i + k] - bg[i + k]);
+      var += std::pow(kernel[k + half], 2) * (error > 0.0 ? error * error : 1.0);
+    }
+    response[i] = sum;
+    significance[i] = sum / std::sqrt(var);
+    gain[i] = kernelGain;
+  }
+
+  // Peaks at significant local maxima of the response
+  std::vector<PeakCandidate> peaks;
+  std::vector<double> amps;
+  for (int i = std::max(b1 - lo, 1); i <= std::min(b2 - lo, n - 2); ++i) {
+    if (response[i] <= 0.0 || significance[i] < fSignificance || response[i] <= response[i - 1] ||
+        response[i] < response[i + 1]) {
+      continue;
+    }
+
+    // Interpolate the maximum with a parabola
+    double curv = response[i - 1] - 2.0 * response[i] + response[i + 1];
+    double delta = curv < 0.0 ? 0.5 * (response[i - 1] - response[i + 1]) / curv : 0.0;
+    delta = std::min(std::max(delta, -0.5), 0.5);
+
+    double amp = response[i] / gain[i];
+    double width = axis->GetBinWidth(lo + i);
+    PeakCandidate peak;
+    peak.fPos = axis->GetBinCenter(lo + i) + delta * width;
+    peak.fSigma = sigma[i] * width;
+    peak.fVol = amp * std::sqrt(2.0 * M_PI) * sigma[i];
+    peak.fBackground = bg[i];
+    peak.fSignificance = significance[i];
+    peaks.push_back(peak);
+    amps.push_back(amp);
+  }
+
+  // Threshold relative to the highest peak
+  double maxAmp = amps.empty() ? 0.0 : *std::max_element(amps.begin(), amps.end());
+  for (std::size_t i = 0; i < peaks.size(); ++i) {
+    if (amps[i] >= fThreshold * maxAmp) {
+      fPeaks.push_back(peaks[i]);
+    }
+  }
+
+  // Group multiplets
+  for (std::size_t i = 0; i < fPeaks.size(); ++i) {
+    const auto &peak = fPeaks[i];
+    if (fGroups.empty() ||
+        peak.fPos - fPeaks[i - 1].fPos > cGroupDistance * std::max(peak.fSigma, fPeaks[i - 1].fSigma)) {
+      PeakGroup group;
+      group.fMin = peak.fPos - cRegionMargin * peak.fSigma;
+      group.fFirst = i;
+      group.fNumPeaks = 0;
+      fGroups.push_back(group);
+    }
+    auto &group = fGroups.back();
+    group.fMax = peak.fPos + cRegionMargin * peak.fSigma;
+    ++group.fNumPeaks;
+  }
+
+  return fPeaks.size();
+}
+
+} // end namespace Fit
+} // end namespace HDTV
@@ -0,0 +1,114 @@
+/*
+ * HDTV - A ROOT-based spectrum analysis software
+ *  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+ *
+ * This file is part of HDTV.
+ *
+ * HDTV is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * HDTV is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HDTV; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ */
+
+#ifndef __PeakFinder_h__
+#define __PeakFinder_h__
+
+#include <vector>
+
+#include "Calibration.hpp"
+
+class TH1;
+
+namespace HDTV {
+namespace Fit {
+
+//! Peak found by the PeakFinder, in the coordinates of the histogram axis
+class PeakCandidate {
+  friend class PeakFinder;
+
+public:
+  double GetPos() const { return fPos; }
+  double GetSigma() const { return fSigma; }
+  double GetVol() const { return fVol; }
+  double GetBackground() const { return fBackground; }
+  //! Filter response in units of its statistical error
+  double GetSignificance() const { return fSignificance; }
+
+private:
+  double fPos{0.0}, fSigma{0.0}, fVol{0.0}, fBackground{0.0}, fSignificance{0.0};
+};
+
+//! Neighbouring peaks that are close enough to be fitted together, and the
+//! fit region for them
+class PeakGroup {
+  friend class PeakFinder;
+
+public:
+  double GetMin() const { return fMin; }
+  double GetMax() const { return fMax; }
+  //! Index of the first peak of the group in the PeakFinder
+  int GetFirst() const { return fFirst; }
+  int GetNumPeaks() const { return fNumPeaks; }
+
+private:
+  double fMin{0.0}, fMax{0.0};
+  int fFirst{0}, fNumPeaks{0};
+};
+
+//! Automatic peak search
+/**
+ * The background is estimated with the SNIP algorithm (C.G. Ryan et al.,
+ * NIM B 34 (1988) 396), on the doubly logarithmic square root of the counts
+ * as in M. Morhac et al., NIM A 401 (1997) 113. Peaks are then detected in
+ * the background subtracted spectrum with a matched filter, the negative
+ * second derivative of a gaussian, at local maxima of its response that are
+ * significant compared to the statistical error of the bins (by default five
+ * standard deviations, which keeps noise out even without a threshold), and
+ * that exceed a threshold relative to the highest peak.
+ *
+ * The expected width of the peaks is given as sigma. With a calibration,
+ * sigma is in energy units and converted to channels at each position, so
+ * the filter follows the calibration. Found peaks come with estimates of
+ * position, width and volume, sorted by position and grouped into multiplets
+ * of peaks less than five sigma apart. The fit region of a group extends 2.5
+ * sigma beyond its outermost peaks.
+ */
+class PeakFinder {
+public:
+  PeakFinder(double sigma, double threshold, double significance = 5.0)
+      : fSigma(sigma), fThreshold(threshold), fSignificance(significance) {}
+
+  void SetCalibration(const Calibration &cal) { fCal = cal; }
+
+  //! Search the bins of hist with centers between min and max, in channels.
+  //! Returns the number of peaks found.
+  int Search(const TH1 &hist, double min, double max);
+
+  int GetNumPeaks() const { return fPeaks.size(); }
+  const PeakCandidate &GetPeak(int i) const { return fPeaks.at(i); }
+  int GetNumGroups() const { return fGroups.size(); }
+  const PeakGroup &GetGroup(int i) const { return fGroups.at(i); }
+
+private:
+  double SigmaAt(double x) const;
+
+  double fSigma, fThreshold, fSignificance;
+  Calibration fCal;
+  std::vector<PeakCandidate> fPeaks;
+  std::vector<PeakGroup> fGroups;
+};
+
+} // end namespace Fit
+} // end namespace HDTV
+
+#endif
@@ -30,8 +30,8 @@
 #include <TError.h>
 #include <TF1.h>
 #include <TH1.h>
-#include <TVirtualFitter.h>
 
+#include "Likelihood.hh"
 #include "Util.hh"
 
 namespace HDTV {
@@ -93,6 +93,7 @@ void PolyBg::Fit(TH1 &hist) {
   if (fnParams < 0) { // Degenerate case, no free parameters in fit
     return;
   }
+  FitStats::Timer timer(fStats, "PolyBg");
 
   // Create function to be used for fitting
   // Note that a polynomial of degree N has N+1 parameters
@@ -104,22 +105,19 @@ void PolyBg::Fit(TH1 &hist) {
   }
 
   // Fit
-  char options[7];
-  sprintf(options, "RQNM%s%s", fIntegrate.GetValue() ? "I" : "", fLikelihood.GetValue() == "poisson" ? "L" : "");
-  hist.Fit(&fitFunc, options);
+  auto covar = FitHistogram(hist, fitFunc, fIntegrate.GetValue(), fLikelihood.GetValue(), fStats);
 
   // Copy chisquare
   fChisquare = fitFunc.GetChisquare();
 
   // Copy covariance matrix (needed for error evaluation)
-  TVirtualFitter *fitter = TVirtualFitter::GetFitter();
-  if (fitter == nullptr) {
+  if (covar.empty()) {
     Error("PolyBg::Fit", "No existing fitter after fit");
   } else {
     fCovar = std::vector<std::vector<double>>(fnParams, std::vector<double>(fnParams + 1));
     for (int i = 0; i < fnParams; ++i) {
       for (int j = 0; j < fnParams; ++j) {
-        fCovar[i][j] = fitter->GetCovarianceMatrixElement(i, j);
+        fCovar[i][j] = covar[i][j];
       }
     }
   }
@@ -132,6 +130,8 @@ void PolyBg::Fit(TH1 &hist) {
     fFunc->SetParameter(i, fitFunc.GetParameter(i));
     fFunc->SetParError(i, fitFunc.GetParError(i));
   }
+  fFunc->SetChisquare(fChisquare);
+  fFunc->SetNDF(fitFunc.GetNDF());
 }
 
 bool PolyBg::Restore(const TArrayD &values, const TArrayD &errors, double ChiSquare) {
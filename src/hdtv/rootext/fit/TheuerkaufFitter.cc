@@ -25,18 +25,82 @@
 #include <cmath>
 
 #include <algorithm>
+#include <array>
+#include <limits>
+#include <map>
 #include <memory>
 #include <numeric>
-
+#include <utility>
+#include <vector>
+
+#include <Math/Factory.h>
+#include <Math/Functor.h>
+#include <Math/Minimizer.h>
+#include <Math/MinimizerOptions.h>
+#include <TDecompSVD.h>
 #include <TError.h>
 #include <TF1.h>
 #include <TH1.h>
+#include <TMatrixD.h>
+#include <TVectorD.h>
 
+#include "Likelihood.hh"
 #include "Util.hh"
 
 namespace HDTV {
 namespace Fit {
 
+// Ratio of full width at half maximum and standard deviation of a gaussian
+static const double cFwhmPerSigma = 2.0 * std::sqrt(2.0 * std::log(2.0));
+
+// *** WidthModel ***
+
+double WidthModel::Sigma(double x, const double *p) const {
+  double e = fOffset + fSlope * x;
+  double fwhm2 = fA.Value(p) + fB.Value(p) * e + fC.Value(p) * e * e;
+
+  // Keep the width positive for the minimizer to recover from bad parameters
+  return std::sqrt(std::max(fwhm2, std::numeric_limits<double>::min())) / (std::abs(fSlope) * cFwhmPerSigma);
+}
+
+//! Error of the width at position x of a peak with position parameter pos,
+//! from the covariance of the last fit. Without covariance, correlations are
+//! neglected.
+double WidthModel::SigmaError(double x, const Param &pos, TF1 *func) const {
+  if (!func) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+
+  const double *p = func->GetParameters();
+  double e = fOffset + fSlope * x;
+  double sigma = Sigma(x, p);
+
+  // d(sigma)/d(fwhm^2) = 1 / (2 sigma (slope * cFwhmPerSigma)^2)
+  double scale = 1.0 / (2.0 * sigma * std::pow(fSlope * cFwhmPerSigma, 2));
+  std::vector<std::pair<int, double>> grad;
+  for (const auto &coeff : {std::make_pair(&fA, 1.0), std::make_pair(&fB, e), std::make_pair(&fC, e * e)}) {
+    if (coeff.first->IsFree()) {
+      grad.emplace_back(coeff.first->_Id(), scale * coeff.second);
+    }
+  }
+  if (pos.IsFree()) {
+    grad.emplace_back(pos._Id(), scale * (fB.Value(p) + 2.0 * fC.Value(p) * e) * fSlope);
+  }
+
+  double var = 0.0;
+  for (const auto &gi : grad) {
+    for (const auto &gj : grad) {
+      if (!fCovar.empty()) {
+        var += gi.second * gj.second * fCovar[gi.first][gj.first];
+      } else if (gi.first == gj.first) {
+        var += std::pow(gi.second * func->GetParError(gi.first), 2);
+      }
+    }
+  }
+
+  return std::sqrt(std::max(var, 0.0));
+}
+
 // *** TheuerkaufPeak ***
 
 //! Constructor
@@ -48,17 +112,19 @@ TheuerkaufPeak::TheuerkaufPeak(const Param &pos, const Param &vol, const Param &
                                const Param &sh, const Param &sw)
     : fPos{pos}, fVol{vol}, fSigma{sigma}, fTL{tl ? tl : Param::Fixed(0.0)}, fTR{tr ? tr : Param::Fixed(0.0)},
       fSH{sh ? sh : Param::Fixed(0.0)}, fSW{sw ? sw : Param::Fixed(1.0)}, fHasLeftTail{tl},
-      fHasRightTail{tr}, fHasStep{sh}, fFunc{nullptr}, fCachedNorm{std::numeric_limits<double>::quiet_NaN()},
-      fCachedSigma{std::numeric_limits<double>::quiet_NaN()}, fCachedTL{std::numeric_limits<double>::quiet_NaN()},
-      fCachedTR{std::numeric_limits<double>::quiet_NaN()} {}
+      fHasRightTail{tr}, fHasStep{sh}, fKernels{SelectKernels()}, fWidthModel{nullptr},
+      fRestoredSigmaError{0.0}, fFunc{nullptr},
+      fCachedNorm{std::numeric_limits<double>::quiet_NaN()}, fCachedSigma{std::numeric_limits<double>::quiet_NaN()},
+      fCachedTL{std::numeric_limits<double>::quiet_NaN()}, fCachedTR{std::numeric_limits<double>::quiet_NaN()} {}
 
 //! Copy constructor
 //! Does not copy the fPeakFunc pointer, it will be re-generated when needed.
 TheuerkaufPeak::TheuerkaufPeak(const TheuerkaufPeak &src)
     : fPos{src.fPos}, fVol{src.fVol}, fSigma{src.fSigma}, fTL{src.fTL}, fTR{src.fTR}, fSH{src.fSH}, fSW{src.fSW},
-      fHasLeftTail{src.fHasLeftTail}, fHasRightTail{src.fHasRightTail}, fHasStep{src.fHasStep}, fFunc{src.fFunc},
-      fCachedNorm{src.fCachedNorm}, fCachedSigma{src.fCachedSigma}, fCachedTL{src.fCachedTL}, fCachedTR{src.fCachedTR} {
-}
+      fHasLeftTail{src.fHasLeftTail}, fHasRightTail{src.fHasRightTail}, fHasStep{src.fHasStep},
+      fKernels{src.fKernels}, fWidthModel{src.fWidthModel}, fRestoredSigmaError{src.fRestoredSigmaError},
+      fFunc{src.fFunc}, fCachedNorm{src.fCachedNorm}, fCachedSigma{src.fCachedSigma},
+      fCachedTL{src.fCachedTL}, fCachedTR{src.fCachedTR} {}
 
 //! Assignment operator (handles self-assignment implicitly)
 TheuerkaufPeak &TheuerkaufPeak::operator=(const TheuerkaufPeak &src) {
@@ -72,6 +138,9 @@ TheuerkaufPeak &TheuerkaufPeak::operator=(const TheuerkaufPeak &src) {
   fHasLeftTail = src.fHasLeftTail;
   fHasRightTail = src.fHasRightTail;
   fHasStep = src.fHasStep;
+  fKernels = src.fKernels;
+  fWidthModel = src.fWidthModel;
+  fRestoredSigmaError = src.fRestoredSigmaError;
   fFunc = src.fFunc;
   fCachedNorm = src.fCachedNorm;
   fCachedSigma = src.fCachedSigma;
@@ -99,6 +168,55 @@ void TheuerkaufPeak::RestoreParam(const Param &param, double value, double error
   }
 }
 
+double TheuerkaufPeak::GetSigma() const {
+  if (fWidthModel) {
+    return fFunc ? Sigma(fFunc->GetParameters()) : std::numeric_limits<double>::quiet_NaN();
+  }
+  return fSigma.Value(fFunc);
+}
+
+double TheuerkaufPeak::GetSigmaError() const {
+  if (fWidthModel) {
+    return fWidthModel->SigmaError(GetPos(), fPos, fFunc);
+  }
+  return fSigma.IsFree() ? fSigma.Error(fFunc) : fRestoredSigmaError;
+}
+
+//! Restores the width. The coefficients of a width model cannot be recovered
+//! from a single peak, so such a peak is detached from the model and keeps the
+//! restored width as a fixed value.
+void TheuerkaufPeak::RestoreSigma(double value, double error) {
+  if (fWidthModel || !fSigma) {
+    fWidthModel = nullptr;
+    fSigma = Param::Fixed(value);
+    fRestoredSigmaError = error;
+    fPeakFunc.reset(nullptr);
+    return;
+  }
+  RestoreParam(fSigma, value, error);
+}
+
+//! Private: parameter by name ("pos", "vol", "width", "tl", "tr", "sh" or
+//! "sw"), nullptr for unknown names
+const Param *TheuerkaufPeak::GetParam(const std::string &name) const {
+  if (name == "pos") {
+    return &fPos;
+  } else if (name == "vol") {
+    return &fVol;
+  } else if (name == "width") {
+    return &fSigma;
+  } else if (name == "tl") {
+    return &fTL;
+  } else if (name == "tr") {
+    return &fTR;
+  } else if (name == "sh") {
+    return &fSH;
+  } else if (name == "sw") {
+    return &fSW;
+  }
+  return nullptr;
+}
+
 const double TheuerkaufPeak::DECOMP_FUNC_WIDTH = 5.0;
 
 TF1 *TheuerkaufPeak::GetPeakFunc() {
@@ -110,8 +228,8 @@ TF1 *TheuerkaufPeak::GetPeakFunc() {
     return nullptr;
   }
 
-  double min = fPos.Value(fFunc) - DECOMP_FUNC_WIDTH * fSigma.Value(fFunc);
-  double max = fPos.Value(fFunc) + DECOMP_FUNC_WIDTH * fSigma.Value(fFunc);
+  double min = fPos.Value(fFunc) - DECOMP_FUNC_WIDTH * GetSigma();
+  double max = fPos.Value(fFunc) + DECOMP_FUNC_WIDTH * GetSigma();
   int numParams = fFunc->GetNpar();
 
   fPeakFunc = std::make_unique<TF1>(GetFuncUniqueName("peak", this).c_str(), this, &TheuerkaufPeak::EvalNoStep, min,
@@ -124,56 +242,79 @@ TF1 *TheuerkaufPeak::GetPeakFunc() {
   return fPeakFunc.get();
 }
 
-double TheuerkaufPeak::Eval(const double *x, const double *p) const { return EvalNoStep(x, p) + EvalStep(x, p); }
+struct TheuerkaufPeak::Kernels {
+  using Kernel_t = double (TheuerkaufPeak::*)(const double *, const double *) const;
+  Kernel_t fEval, fEvalNoStep, fEvalStep;
+};
+
+template <bool LeftTail, bool RightTail, bool Step> TheuerkaufPeak::Kernels TheuerkaufPeak::MakeKernels() {
+  return {&TheuerkaufPeak::EvalKernel<LeftTail, RightTail, true, Step>,
+          &TheuerkaufPeak::EvalKernel<LeftTail, RightTail, true, false>,
+          &TheuerkaufPeak::EvalKernel<LeftTail, RightTail, false, Step>};
+}
+
+// Indexed by 4 * fHasLeftTail + 2 * fHasRightTail + fHasStep
+const TheuerkaufPeak::Kernels TheuerkaufPeak::cKernels[8] = {
+    MakeKernels<false, false, false>(), MakeKernels<false, false, true>(), MakeKernels<false, true, false>(),
+    MakeKernels<false, true, true>(),   MakeKernels<true, false, false>(), MakeKernels<true, false, true>(),
+    MakeKernels<true, true, false>(),   MakeKernels<true, true, true>()};
+
+const TheuerkaufPeak::Kernels *TheuerkaufPeak::SelectKernels() const {
+  return &cKernels[fHasLeftTail * 4 + fHasRightTail * 2 + fHasStep];
+}
+
+double TheuerkaufPeak::Eval(const double *x, const double *p) const { return (this->*fKernels->fEval)(x, p); }
 
 double TheuerkaufPeak::EvalNoStep(const double *x, const double *p) const {
+  return (this->*fKernels->fEvalNoStep)(x, p);
+}
+
+double TheuerkaufPeak::EvalStep(const double *x, const double *p) const { return (this->*fKernels->fEvalStep)(x, p); }
+
+template <bool LeftTail, bool RightTail, bool WithPeak, bool WithStep>
+double TheuerkaufPeak::EvalKernel(const double *x, const double *p) const {
+  if (!WithPeak && !WithStep) {
+    return 0.0;
+  }
+
   double dx = *x - fPos.Value(p);
   double vol = fVol.Value(p);
-  double sigma = fSigma.Value(p);
+  double sigma = Sigma(p);
   double tl = fTL.Value(p);
   double tr = fTR.Value(p);
   double norm = GetNorm(sigma, tl, tr);
-  double _x;
+  double sum = 0.0;
 
   // Peak function
-  if (dx < -tl && fHasLeftTail) {
-    _x = tl / (sigma * sigma) * (dx + tl / 2.0);
-  } else if (dx < tr || !fHasRightTail) {
-    _x = -dx * dx / (2.0 * sigma * sigma);
-  } else {
-    _x = -tr / (sigma * sigma) * (dx - tr / 2.0);
+  if (WithPeak) {
+    double _x;
+    if (LeftTail && dx < -tl) {
+      _x = tl / (sigma * sigma) * (dx + tl / 2.0);
+    } else if (!RightTail || dx < tr) {
+      _x = -dx * dx / (2.0 * sigma * sigma);
+    } else {
+      _x = -tr / (sigma * sigma) * (dx - tr / 2.0);
+    }
+    sum += std::exp(_x);
   }
 
-  return vol * norm * std::exp(_x);
-}
-
-double TheuerkaufPeak::EvalStep(const double *x, const double *p) const {
-  //! Step function
-
-  if (fHasStep) {
-    double dx = *x - fPos.Value(p);
-    double sigma = fSigma.Value(p);
+  // Step function
+  if (WithStep) {
     double sh = fSH.Value(p);
     double sw = fSW.Value(p);
-
-    double vol = fVol.Value(p);
-    double norm = GetNorm(sigma, fTL.Value(p), fTR.Value(p));
-
-    return vol * norm * sh * (M_PI / 2. + std::atan(sw * dx / (std::sqrt(2.) * sigma)));
-  } else {
-    return 0.0;
+    sum += sh * (M_PI / 2. + std::atan(sw * dx / (std::sqrt(2.) * sigma)));
   }
-}
 
-double TheuerkaufPeak::GetNorm(double sigma, double tl, double tr) const {
-  if (fCachedSigma == sigma && fCachedTL == tl && fCachedTR == tr) {
-    return fCachedNorm;
-  }
+  return vol * norm * sum;
+}
 
+//! Integral of the peak function (without step) of unit amplitude. Tails at
+//! infinity are the same as no tails.
+static double PeakIntegral(double sigma, double tl, double tr, bool leftTail, bool rightTail) {
   double vol;
 
   // Contribution from left tail + left half of truncated gaussian
-  if (fHasLeftTail) {
+  if (leftTail) {
     vol = (sigma * sigma) / tl * std::exp(-(tl * tl) / (2.0 * sigma * sigma));
     vol += std::sqrt(M_PI / 2.0) * sigma * std::erf(tl / (std::sqrt(2.0) * sigma));
   } else {
@@ -181,22 +322,41 @@ double TheuerkaufPeak::GetNorm(double sigma, double tl, double tr) const {
   }
 
   // Contribution from right tail + right half of truncated gaussian
-  if (fHasRightTail) {
+  if (rightTail) {
     vol += (sigma * sigma) / tr * std::exp(-(tr * tr) / (2.0 * sigma * sigma));
     vol += std::sqrt(M_PI / 2.0) * sigma * std::erf(tr / (std::sqrt(2.0) * sigma));
   } else {
     vol += std::sqrt(M_PI / 2.0) * sigma;
   }
 
+  return vol;
+}
+
+double TheuerkaufPeak::GetNorm(double sigma, double tl, double tr) const {
+  if (fCachedSigma == sigma && fCachedTL == tl && fCachedTR == tr) {
+    return fCachedNorm;
+  }
+
   fCachedSigma = sigma;
   fCachedTL = tl;
   fCachedTR = tr;
-  fCachedNorm = 1. / vol;
+  fCachedNorm = 1. / PeakIntegral(sigma, tl, tr, fHasLeftTail, fHasRightTail);
 
   return fCachedNorm;
 }
 
 // *** TheuerkaufFitter ***
+void TheuerkaufFitter::SetWidthModel(const WidthModel &model) {
+  //! Sets the width model for peaks without a sigma parameter. Must be called
+  //! before adding such peaks.
+
+  if (IsFinal()) {
+    return;
+  }
+
+  fWidthModel = model;
+}
+
 void TheuerkaufFitter::AddPeak(const TheuerkaufPeak &peak) {
   //! Adds a peak to the peak list
 
@@ -204,7 +364,15 @@ void TheuerkaufFitter::AddPeak(const TheuerkaufPeak &peak) {
     return;
   }
 
+  if (!peak.fSigma && !fWidthModel) {
+    Warning("HDTV::TheuerkaufFitter::AddPeak", "peak without sigma parameter, but no width model set");
+    return;
+  }
+
   fPeaks.push_back(peak);
+  if (!peak.fSigma) {
+    fPeaks.back().fWidthModel = &fWidthModel;
+  }
   fNumPeaks++;
 }
 
@@ -302,6 +470,240 @@ void TheuerkaufFitter::Fit(TH1 &hist, int intNParams) {
 
 //! Private: worker function to actually do the fit
 void TheuerkaufFitter::_Fit(TH1 &hist) {
+  FitStats::Timer timer(fStats, "TheuerkaufFitter");
+  _Init(hist);
+
+  if (!fDebugShowInipar) {
+    // Optionally, locate the minimum with the linear parameters projected out
+    // first. The regular fit below then starts at the optimum and essentially
+    // only has to calculate the errors.
+    if (fVarPro.GetValue()) {
+      _VarProFit(hist);
+    }
+
+    // Now, do the fit. The covariance is kept for the errors of the widths
+    // derived from the width model.
+    auto covar = FitHistogram(hist, *fSumFunc, fIntegrate.GetValue(), fLikelihood.GetValue(), fStats);
+    if (fWidthModel) {
+      fWidthModel.fCovar = std::move(covar);
+    }
+
+    // Store Chi^2
+    fChisquare = fSumFunc->GetChisquare();
+  }
+
+  // Finalize fitter
+  fFinal = true;
+}
+
+// Range of tails (in units of sigma) that is estimated from the skewness of a
+// peak. Beyond the upper limit, the skewness is too small to be measured.
+static const double cMinTail = 0.25;
+static const double cMaxTail = 4.0;
+
+//! Skewness of a peak with unit sigma and a left tail starting at t
+static double TailSkewness(double t) {
+  // Raw moments of the truncated gaussian and the tail together
+  double e = std::exp(-t * t / 2.0);
+  double g0 = std::sqrt(M_PI / 2.0) * (1.0 + std::erf(t / std::sqrt(2.0)));
+  double m0 = g0 + e / t;
+  double m1 = -e / (t * t) / m0;
+  double m2 = (g0 + 2.0 * e / t + 2.0 * e / (t * t * t)) / m0;
+  double m3 = -e * (1.0 + 6.0 / (t * t) + 6.0 / (t * t * t * t)) / m0;
+
+  double var = m2 - m1 * m1;
+  return (m3 - 3.0 * m1 * m2 + 2.0 * m1 * m1 * m1) / std::pow(var, 1.5);
+}
+
+//! Inverse of TailSkewness(), limited to [cMinTail, cMaxTail]
+static double TailFromSkewness(double skew) {
+  double lower = cMinTail, upper = cMaxTail;
+  if (skew <= TailSkewness(lower)) {
+    return lower;
+  }
+
+  // The skewness increases monotonically with t
+  for (int i = 0; i < 40; ++i) {
+    double mid = (lower + upper) / 2.0;
+    if (TailSkewness(mid) < skew) {
+      lower = mid;
+    } else {
+      upper = mid;
+    }
+  }
+  return (lower + upper) / 2.0;
+}
+
+//! Estimated shape of a peak. Infinite tails stand for no tail, or none that
+//! could be estimated. Only the parameters marked as fit are estimated.
+struct PeakEstimate {
+  double pos, vol, sigma, tl, tr;
+  bool fitPos, fitVol, fitSigma, fitLeftTail, fitRightTail;
+};
+
+//! Background subtracted bin contents of the fit region
+struct BinData {
+  std::vector<double> x, width, counts, error;
+};
+
+//! Peak function of an estimate, as TheuerkaufPeak::EvalNoStep()
+static double EvalEstimate(const PeakEstimate &peak, double x) {
+  double dx = x - peak.pos;
+  double sigma2 = peak.sigma * peak.sigma;
+  double arg;
+  if (dx < -peak.tl) {
+    arg = peak.tl / sigma2 * (dx + peak.tl / 2.0);
+  } else if (dx < peak.tr) {
+    arg = -dx * dx / (2.0 * sigma2);
+  } else {
+    arg = -peak.tr / sigma2 * (dx - peak.tr / 2.0);
+  }
+  return peak.vol * std::exp(arg) / PeakIntegral(peak.sigma, peak.tl, peak.tr, true, true);
+}
+
+//! Refine the estimates of the peak shapes
+/**
+ * The counts of each bin are shared among the peaks in proportion to their
+ * current estimates, which separates overlapping peaks. In a window around
+ * each peak, the moments of its share (centroid, width and skewness) are then
+ * compared to those of the estimated peak in the same window, which accounts
+ * for the truncation by the window and for the binning, and the estimate is
+ * corrected by the difference. A skewness that is significant compared to the
+ * statistical error of the bins is attributed to a tail.
+ *
+ * If fitOffset is set, a constant offset of the background is estimated in
+ * addition, and returned. Of all iterations, the one with the lowest chi^2 is
+ * kept.
+ */
+static double EstimatePeaks(BinData bins, std::vector<PeakEstimate> &peaks, double maxSigma, bool fitOffset) {
+  const int cIterations = 8;
+  const std::size_t nBins = bins.x.size();
+
+  std::vector<double> startPos, startSigma;
+  for (const auto &peak : peaks) {
+    startPos.push_back(peak.pos);
+    startSigma.push_back(peak.sigma);
+  }
+
+  std::vector<std::vector<double>> model(peaks.size(), std::vector<double>(nBins));
+  std::vector<double> total(nBins);
+  auto evalModel = [&]() {
+    std::fill(total.begin(), total.end(), 0.0);
+    for (std::size_t i = 0; i < peaks.size(); ++i) {
+      for (std::size_t b = 0; b < nBins; ++b) {
+        model[i][b] = EvalEstimate(peaks[i], bins.x[b]) * bins.width[b];
+        total[b] += model[i][b];
+      }
+    }
+  };
+  auto chisquare = [&]() {
+    double chi2 = 0.0;
+    for (std::size_t b = 0; b < nBins; ++b) {
+      chi2 += std::pow((bins.counts[b] - total[b]) / bins.error[b], 2);
+    }
+    return chi2;
+  };
+
+  evalModel();
+  double offset = 0.0;
+  double bestOffset = 0.0;
+  double bestChisquare = chisquare();
+  std::vector<PeakEstimate> best = peaks;
+
+  for (int iter = 0; iter < cIterations; ++iter) {
+    if (fitOffset) {
+      double sum = 0.0, sumWeight = 0.0;
+      for (std::size_t b = 0; b < nBins; ++b) {
+        double weight = 1.0 / (bins.error[b] * bins.error[b]);
+        sum += weight * (bins.counts[b] - total[b]);
+        sumWeight += weight;
+      }
+      double delta = sum / sumWeight;
+      offset += delta;
+      for (auto &counts : bins.counts) {
+        counts -= delta;
+      }
+    }
+
+    for (std::size_t i = 0; i < peaks.size(); ++i) {
+      auto &peak = peaks[i];
+      bool tails = std::isfinite(peak.tl) || std::isfinite(peak.tr) || peak.fitLeftTail || peak.fitRightTail;
+      double window = (tails ? 4.0 : 3.0) * peak.sigma;
+
+      // Raw moments around the current position, of the share of the counts
+      // and of the estimated peak, and the variance of the third moment of
+      // the share
+      std::array<double, 4> data{}, shape{};
+      double var3 = 0.0;
+      for (std::size_t b = 0; b < nBins; ++b) {
+        double dx = bins.x[b] - peak.pos;
+        if (std::abs(dx) > window || total[b] <= 0.0) {
+          continue;
+        }
+        double share = model[i][b] / total[b];
+        double power = 1.0;
+        for (int k = 0; k < 4; ++k) {
+          data[k] += share * bins.counts[b] * power;
+          shape[k] += model[i][b] * power;
+          power *= dx;
+        }
+        var3 += std::pow(share * bins.error[b] * dx * dx * dx, 2);
+      }
+      if (data[0] <= 0.0 || shape[0] <= 0.0) {
+        continue;
+      }
+
+      double dataMean = data[1] / data[0], shapeMean = shape[1] / shape[0];
+      double dataVar = data[2] / data[0] - dataMean * dataMean;
+      double shapeVar = shape[2] / shape[0] - shapeMean * shapeMean;
+      double dataM3 = data[3] / data[0] - 3.0 * dataMean * data[2] / data[0] + 2.0 * std::pow(dataMean, 3);
+      double shapeM3 = shape[3] / shape[0] - 3.0 * shapeMean * shape[2] / shape[0] + 2.0 * std::pow(shapeMean, 3);
+
+      if (peak.fitVol) {
+        peak.vol *= data[0] / shape[0];
+      }
+      if (peak.fitPos) {
+        peak.pos = std::min(std::max(peak.pos + dataMean - shapeMean, startPos[i] - startSigma[i]),
+                            startPos[i] + startSigma[i]);
+      }
+      if (dataVar <= 0.0 || shapeVar <= 0.0) {
+        continue;
+      }
+
+      double sigma = peak.sigma;
+      if (peak.fitSigma) {
+        peak.sigma = std::min(sigma * std::min(std::max(std::sqrt(dataVar / shapeVar), 0.5), 2.0), maxSigma);
+      }
+
+      double excessSkew = dataM3 / std::pow(dataVar, 1.5) - shapeM3 / std::pow(shapeVar, 1.5);
+      double skewError = std::sqrt(var3) / (data[0] * std::pow(dataVar, 1.5));
+      if (peak.fitLeftTail) {
+        double skew = (std::isfinite(peak.tl) ? TailSkewness(peak.tl / sigma) : 0.0) + excessSkew;
+        peak.tl = skew < -2.0 * skewError ? TailFromSkewness(skew) * peak.sigma
+                                          : std::numeric_limits<double>::infinity();
+      }
+      if (peak.fitRightTail) {
+        double skew = (std::isfinite(peak.tr) ? -TailSkewness(peak.tr / sigma) : 0.0) + excessSkew;
+        peak.tr = skew > 2.0 * skewError ? TailFromSkewness(-skew) * peak.sigma
+                                         : std::numeric_limits<double>::infinity();
+      }
+    }
+
+    evalModel();
+    double chi2 = chisquare();
+    if (chi2 < bestChisquare) {
+      bestChisquare = chi2;
+      bestOffset = offset;
+      best = peaks;
+    }
+  }
+
+  peaks = best;
+  return bestOffset;
+}
+
+//! Private: create the fit function and estimate initial parameters
+void TheuerkaufFitter::_Init(TH1 &hist) {
   // Allocate additional parameters for internal polynomial background
   // Note that a polynomial of degree n has n+1 parameters!
   if (fIntNParams >= 1) {
@@ -495,41 +897,413 @@ void TheuerkaufFitter::_Fit(TH1 &hist) {
     }
   }
 
-  // Init fit parameters for peaks
+  // Refine the estimates for each peak from the moments of the counts around
+  // it (see EstimatePeaks()), starting from the ones above. Parameters with
+  // an initial value given are kept. Positions are refined by at most one
+  // average width. If the average width is not sensible, the estimates above
+  // are used as they are.
+  std::vector<PeakEstimate> estimates;
+  estimates.reserve(fPeaks.size());
   ampIter = amps.begin();
+  for (const auto &peak : fPeaks) {
+    double amp = *(ampIter++);
+    PeakEstimate est;
+    est.pos = peak.fPos._Value();
+    est.fitPos = peak.fPos.IsFree();
+    est.fitVol = !peak.fVol.HasIVal();
+    est.vol = est.fitVol ? sumFreeVol * amp / sumFreeAmp : peak.fVol._Value();
+    if (peak.fWidthModel) {
+      est.fitSigma = peak.fWidthModel->IsFree();
+      est.sigma = est.fitSigma ? avgSigma : peak.fWidthModel->Sigma(est.pos, nullptr);
+    } else {
+      est.fitSigma = !peak.fSigma.HasIVal();
+      est.sigma = est.fitSigma ? avgSigma : peak.fSigma._Value();
+    }
+    est.fitLeftTail = peak.fHasLeftTail && !peak.fTL.HasIVal();
+    est.tl = peak.fHasLeftTail && !est.fitLeftTail ? peak.fTL._Value() : std::numeric_limits<double>::infinity();
+    est.fitRightTail = peak.fHasRightTail && !peak.fTR.HasIVal();
+    est.tr = peak.fHasRightTail && !est.fitRightTail ? peak.fTR._Value() : std::numeric_limits<double>::infinity();
+    estimates.push_back(est);
+  }
+
+  if (std::isfinite(avgSigma) && avgSigma > 0.0) {
+    // Bin contents with all background and (sharp) steps substracted
+    BinData bins;
+    for (int b = b1; b <= b2; ++b) {
+      double x = hist.GetBinCenter(b);
+      double counts = hist.GetBinContent(b) - intBg0;
+      if (fBackground != nullptr) {
+        counts -= fBackground->Eval(x);
+      }
+      for (const auto &peak : fPeaks) {
+        if (peak.HasStep() && x > peak.fPos._Value()) {
+          counts -= peak.fSH.IsFree() ? avgFreeStep : peak.fSH._Value();
+        }
+      }
+      double error = hist.GetBinError(b);
+      bins.x.push_back(x);
+      bins.width.push_back(hist.GetBinWidth(b));
+      bins.counts.push_back(counts);
+      bins.error.push_back(error > 0.0 ? error : 1.0);
+    }
+
+    // The constant of the internal background is refined along with the peaks
+    double offset = EstimatePeaks(std::move(bins), estimates, (fMax - fMin) / 4.0, fIntNParams >= 1);
+    if (fIntNParams >= 1) {
+      fSumFunc->SetParameter(fNumParams - fIntNParams, intBg0 + offset);
+    }
+
+    // Parameters shared by several peaks get the mean of their estimates,
+    // weighted by volume
+    auto share = [&](Param TheuerkaufPeak::*param, double PeakEstimate::*value) {
+      std::map<int, std::pair<double, double>> sums;
+      for (PeakID_t id = 0; id < fPeaks.size(); ++id) {
+        const Param &p = fPeaks[id].*param;
+        if (p.IsFree() && std::isfinite(estimates[id].*value)) {
+          auto &sum = sums[p._Id()];
+          sum.first += std::abs(estimates[id].vol) * estimates[id].*value;
+          sum.second += std::abs(estimates[id].vol);
+        }
+      }
+      for (PeakID_t id = 0; id < fPeaks.size(); ++id) {
+        const Param &p = fPeaks[id].*param;
+        auto iter = sums.find(p._Id());
+        if (p.IsFree() && iter != sums.end() && iter->second.second > 0.0) {
+          estimates[id].*value = iter->second.first / iter->second.second;
+        }
+      }
+    };
+    share(&TheuerkaufPeak::fSigma, &PeakEstimate::sigma);
+    share(&TheuerkaufPeak::fTL, &PeakEstimate::tl);
+    share(&TheuerkaufPeak::fTR, &PeakEstimate::tr);
+  }
+
+  // Init fit parameters for peaks. Tails that could not be estimated start
+  // far out.
+  ampIter = amps.begin();
+  auto estIter = estimates.begin();
   for (auto &peak : fPeaks) {
     double amp = *(ampIter++);
-    SetParameter(*fSumFunc, peak.fPos);
+    const auto &est = *(estIter++);
+    // SetParameter() would keep the marker position, not the refined one
+    if (peak.fPos.IsFree()) {
+      fSumFunc->SetParameter(peak.fPos._Id(), est.pos);
+    }
     if (fOnlypositivepeaks.GetValue()) {
       // The root fit algorithm produces strange results when fitting with extreme limits/boundary conditions, hence set
       // some sane upper limits
-      SetParameter(*fSumFunc, peak.fVol, std::max(sumFreeVol * amp / sumFreeAmp, 1.), true, 0.,
-                   std::max(100. * sumVol, 0.) + 1e9);
-      SetParameter(*fSumFunc, peak.fSigma, avgSigma, true, 0., 10 * (fMax - fMin) + 1e3);
+      SetParameter(*fSumFunc, peak.fVol, std::max(est.vol, 1.), true, 0., std::max(100. * sumVol, 0.) + 1e9);
+      SetParameter(*fSumFunc, peak.fSigma, est.sigma, true, 0., 10 * (fMax - fMin) + 1e3);
     } else {
-      SetParameter(*fSumFunc, peak.fVol, sumFreeVol * amp / sumFreeAmp);
-      SetParameter(*fSumFunc, peak.fSigma, avgSigma);
+      SetParameter(*fSumFunc, peak.fVol, est.vol);
+      SetParameter(*fSumFunc, peak.fSigma, est.sigma);
     }
-    SetParameter(*fSumFunc, peak.fTL, 10.0);
-    SetParameter(*fSumFunc, peak.fTR, 10.0);
+    SetParameter(*fSumFunc, peak.fTL, std::isfinite(est.tl) ? est.tl : 10.0);
+    SetParameter(*fSumFunc, peak.fTR, std::isfinite(est.tr) ? est.tr : 10.0);
     SetParameter(*fSumFunc, peak.fSH, avgFreeStep / (amp * M_PI));
     SetParameter(*fSumFunc, peak.fSW, 1.0);
 
     peak.SetSumFunc(fSumFunc.get());
   }
 
-  if (!fDebugShowInipar) {
-    // Now, do the fit
-    char options[7];
-    sprintf(options, "RQNM%s%s", fIntegrate.GetValue() ? "I" : "", fLikelihood.GetValue() == "poisson" ? "L" : "");
-    hist.Fit(fSumFunc.get(), options);
+  // Init width model from the widths estimated for the peaks: the squared
+  // fwhm is a volume weighted straight line through them, if the linear
+  // coefficient is free, and a constant otherwise. The step sizes of the
+  // linear and quadratic coefficients are chosen such that they change the
+  // width over the fit region by a similar amount as the constant.
+  if (fWidthModel && !fPeaks.empty()) {
+    auto energy = [&](const PeakEstimate &est) { return fWidthModel.fOffset + fWidthModel.fSlope * est.pos; };
+    auto fwhm2 = [&](const PeakEstimate &est) {
+      return std::pow(est.sigma * std::abs(fWidthModel.fSlope) * cFwhmPerSigma, 2);
+    };
+    auto weight = [](const PeakEstimate &est) { return std::max(std::abs(est.vol), 1.0); };
 
-    // Store Chi^2
-    fChisquare = fSumFunc->GetChisquare();
+    double sumWeight = 0.0, meanE = 0.0, meanFwhm2 = 0.0;
+    for (const auto &est : estimates) {
+      sumWeight += weight(est);
+      meanE += weight(est) * energy(est);
+      meanFwhm2 += weight(est) * fwhm2(est);
+    }
+    meanE /= sumWeight;
+    meanFwhm2 /= sumWeight;
+
+    double slope = 0.0;
+    if (fWidthModel.fB.IsFree()) {
+      double sxx = 0.0, sxy = 0.0;
+      for (const auto &est : estimates) {
+        sxx += weight(est) * std::pow(energy(est) - meanE, 2);
+        sxy += weight(est) * (energy(est) - meanE) * (fwhm2(est) - meanFwhm2);
+      }
+      if (sxx > 0.0) {
+        slope = sxy / sxx;
+      }
+      // The fwhm must stay real over the fit region
+      for (double x : {fMin, fMax}) {
+        if (meanFwhm2 + slope * (fWidthModel.fOffset + fWidthModel.fSlope * x - meanE) <= 0.0) {
+          slope = 0.0;
+        }
+      }
+    }
+
+    double scale = std::max(std::abs(meanE), std::abs(fWidthModel.fSlope) * (fMax - fMin));
+
+    SetParameter(*fSumFunc, fWidthModel.fB, slope);
+    SetParameter(*fSumFunc, fWidthModel.fC, 0.0);
+    SetParameter(*fSumFunc, fWidthModel.fA,
+                 meanFwhm2 - fWidthModel.fB._Value() * meanE - fWidthModel.fC._Value() * meanE * meanE);
+    if (fWidthModel.fB.IsFree() && scale > 0.0) {
+      fSumFunc->SetParError(fWidthModel.fB._Id(), 0.1 * meanFwhm2 / scale);
+    }
+    if (fWidthModel.fC.IsFree() && scale > 0.0) {
+      fSumFunc->SetParError(fWidthModel.fC._Id(), 0.1 * meanFwhm2 / (scale * scale));
+    }
   }
+}
 
-  // Finalize fitter
-  fFinal = true;
+//! Private: variable projection fit
+//! The peak volumes and the coefficients of the internal background enter the
+//! fit function linearly. For any given set of the remaining (nonlinear)
+//! parameters, they are therefore obtained exactly by a weighted linear least
+//! squares solution, and the minimizer only has to search the space of the
+//! nonlinear parameters. On success, the parameters of fSumFunc are set to the
+//! optimum found. Returns false if the fit is not suited for variable
+//! projection (poisson likelihood, no linear parameters, too few bins), or the
+//! minimizer could not be created or did not converge; fSumFunc is left
+//! untouched then.
+bool TheuerkaufFitter::_VarProFit(TH1 &hist) {
+  if (fLikelihood.GetValue() == "poisson") {
+    return false;
+  }
+
+  // Linear parameters: free peak volumes, followed by the internal background
+  std::vector<PeakID_t> linPeaks;
+  std::vector<bool> isLinear(fNumParams, false);
+  for (PeakID_t id = 0; id < fPeaks.size(); ++id) {
+    if (fPeaks[id].fVol.IsFree()) {
+      linPeaks.push_back(id);
+      isLinear[fPeaks[id].fVol._Id()] = true;
+    }
+  }
+  int nBg = std::max(fIntNParams, 0);
+  for (int i = fNumParams - nBg; i < fNumParams; ++i) {
+    isLinear[i] = true;
+  }
+  int nLin = linPeaks.size() + nBg;
+
+  std::vector<int> nonLin;
+  for (int i = 0; i < fNumParams; ++i) {
+    if (!isLinear[i]) {
+      nonLin.push_back(i);
+    }
+  }
+
+  // Fit data. As in ROOT's chi^2 fit, bins without error are skipped. With
+  // integration, the function is averaged over each bin by Gauss-Legendre
+  // quadrature; otherwise, it is evaluated at the bin center.
+  int nNodes = fIntegrate.GetValue() ? cGaussLegendreOrder : 1;
+  std::vector<double> xs, nodeWeights, sqrtW, ys;
+  for (int b = 1; b <= hist.GetNbinsX(); ++b) {
+    double center = hist.GetBinCenter(b);
+    double err = hist.GetBinError(b);
+    if (center < fMin || center > fMax || err <= 0.0) {
+      continue;
+    }
+    if (nNodes == 1) {
+      xs.push_back(center);
+      nodeWeights.push_back(1.0);
+    } else {
+      double halfWidth = hist.GetBinWidth(b) / 2.0;
+      for (int k = 0; k < nNodes; ++k) {
+        xs.push_back(center + halfWidth * cGaussLegendreNodes[k]);
+        nodeWeights.push_back(cGaussLegendreWeights[k] / 2.0);
+      }
+    }
+    sqrtW.push_back(1.0 / err);
+    ys.push_back(hist.GetBinContent(b) / err);
+  }
+  int nBins = ys.size();
+  if (nLin == 0 || nBins <= nLin) {
+    return false;
+  }
+
+  // Terms that do not depend on the parameters: the external background is
+  // subtracted from the data, and the background polynomial is tabulated.
+  TMatrixD bgBasis(nBins, std::max(nBg, 1));
+  for (int i = 0; i < nBins; ++i) {
+    for (int k = 0; k < nNodes; ++k) {
+      double x = xs[i * nNodes + k];
+      double w = nodeWeights[i * nNodes + k] * sqrtW[i];
+      if (fBackground) {
+        ys[i] -= w * fBackground->Eval(x);
+      }
+      double xn = 1.0;
+      for (int j = 0; j < nBg; ++j) {
+        bgBasis(i, j) += w * xn;
+        xn *= x;
+      }
+    }
+  }
+
+  std::vector<double> params(fSumFunc->GetParameters(), fSumFunc->GetParameters() + fNumParams);
+  TMatrixD design(nBins, nLin);
+  TVectorD coeffs(nLin);
+
+  // Solve for the linear parameters, given the nonlinear ones in params, and
+  // return chi^2. If only positive peaks are allowed, volumes that come out
+  // negative are pinned at zero one by one, and the rest is solved again.
+  auto solve = [&]() -> double {
+    std::vector<double> p(params);
+    for (auto id : linPeaks) {
+      p[fPeaks[id].fVol._Id()] = 1.0;
+    }
+
+    TVectorD rhs(nBins);
+    for (int i = 0; i < nBins; ++i) {
+      double fixed = 0.0;
+      for (int j = 0; j < nLin; ++j) {
+        design(i, j) = j < static_cast<int>(linPeaks.size()) ? 0.0 : bgBasis(i, j - linPeaks.size());
+      }
+      for (int k = 0; k < nNodes; ++k) {
+        const double *x = &xs[i * nNodes + k];
+        double w = nodeWeights[i * nNodes + k] * sqrtW[i];
+        int j = 0;
+        for (PeakID_t id = 0; id < fPeaks.size(); ++id) {
+          if (j < static_cast<int>(linPeaks.size()) && linPeaks[j] == id) {
+            design(i, j++) += w * fPeaks[id].Eval(x, p.data());
+          } else {
+            fixed += w * fPeaks[id].Eval(x, p.data());
+          }
+        }
+      }
+      rhs(i) = ys[i] - fixed;
+    }
+
+    std::vector<bool> active(nLin, true);
+    while (true) {
+      // Columns are normalized, as their scales differ by many orders of
+      // magnitude (x^n for the background). Columns that vanish in the fit
+      // region get a zero coefficient.
+      std::vector<int> cols;
+      std::vector<double> scale;
+      for (int j = 0; j < nLin; ++j) {
+        coeffs(j) = 0.0;
+        double norm = 0.0;
+        for (int i = 0; i < nBins; ++i) {
+          norm += design(i, j) * design(i, j);
+        }
+        if (active[j] && norm > 0.0) {
+          cols.push_back(j);
+          scale.push_back(1.0 / std::sqrt(norm));
+        }
+      }
+      if (cols.empty()) {
+        break;
+      }
+
+      TMatrixD a(nBins, cols.size());
+      for (std::size_t n = 0; n < cols.size(); ++n) {
+        for (int i = 0; i < nBins; ++i) {
+          a(i, n) = design(i, cols[n]) * scale[n];
+        }
+      }
+
+      // On failure, the coefficients stay at zero, which gives a poor but
+      // finite chi^2 for the minimizer to move away from
+      TDecompSVD svd(a);
+      TVectorD c(rhs);
+      if (!svd.Solve(c)) {
+        break;
+      }
+      for (std::size_t n = 0; n < cols.size(); ++n) {
+        coeffs(cols[n]) = c(n) * scale[n];
+      }
+
+      if (!fOnlypositivepeaks.GetValue()) {
+        break;
+      }
+      int worst = -1;
+      for (int j = 0; j < static_cast<int>(linPeaks.size()); ++j) {
+        if (active[j] && coeffs(j) < 0.0 && (worst < 0 || coeffs(j) < coeffs(worst))) {
+          worst = j;
+        }
+      }
+      if (worst < 0) {
+        break;
+      }
+      active[worst] = false;
+    }
+
+    TVectorD resid(rhs);
+    resid -= design * coeffs;
+    return resid.Norm2Sqr();
+  };
+
+  // Search the nonlinear parameters
+  if (!nonLin.empty()) {
+    std::unique_ptr<ROOT::Math::Minimizer> minimizer(ROOT::Math::Factory::CreateMinimizer(
+        ROOT::Math::MinimizerOptions::DefaultMinimizerType(), ROOT::Math::MinimizerOptions::DefaultMinimizerAlgo()));
+    if (!minimizer) {
+      return false;
+    }
+
+    ROOT::Math::Functor chi2(
+        [&](const double *q) {
+          for (std::size_t k = 0; k < nonLin.size(); ++k) {
+            params[nonLin[k]] = q[k];
+          }
+          return solve();
+        },
+        nonLin.size());
+    minimizer->SetFunction(chi2);
+    minimizer->SetPrintLevel(0);
+
+    for (std::size_t k = 0; k < nonLin.size(); ++k) {
+      int id = nonLin[k];
+      double value = params[id];
+      // Errors set beforehand serve as step size hints
+      double step = fSumFunc->GetParError(id);
+      if (step <= 0.0) {
+        step = value != 0.0 ? 0.1 * std::abs(value) : 0.1;
+      }
+      // Positions are moved in fractions of the peak width instead
+      for (auto &peak : fPeaks) {
+        if (peak.fPos.IsFree() && peak.fPos._Id() == id) {
+          step = 0.1 * std::abs(peak.Sigma(params.data()));
+        }
+      }
+      double lower, upper;
+      fSumFunc->GetParLimits(id, lower, upper);
+      std::string name = fSumFunc->GetParName(id);
+      if (lower < upper) {
+        minimizer->SetLimitedVariable(k, name, value, step, lower, upper);
+      } else {
+        minimizer->SetVariable(k, name, value, step);
+      }
+    }
+
+    bool converged = minimizer->Minimize();
+    fStats.AddMinimization(minimizer->NCalls(), minimizer->Status(), minimizer->Edm());
+    if (!converged) {
+      Warning("HDTV::TheuerkaufFitter::Fit", "variable projection fit failed (status %d), using the start parameters",
+              minimizer->Status());
+      return false;
+    }
+    for (std::size_t k = 0; k < nonLin.size(); ++k) {
+      params[nonLin[k]] = minimizer->X()[k];
+    }
+  }
+
+  // Store the optimum
+  solve();
+  for (int j = 0; j < static_cast<int>(linPeaks.size()); ++j) {
+    params[fPeaks[linPeaks[j]].fVol._Id()] = coeffs(j);
+  }
+  for (int j = 0; j < nBg; ++j) {
+    params[fNumParams - nBg + j] = coeffs(linPeaks.size() + j);
+  }
+  fSumFunc->SetParameters(params.data());
+
+  return true;
 }
 
 //! Restore the fit, using the given background function
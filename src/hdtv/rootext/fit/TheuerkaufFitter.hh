@@ -39,8 +39,40 @@ class TH1;
 namespace HDTV {
 namespace Fit {
 
+class Bootstrap;
+class MultiFitter;
 class TheuerkaufFitter;
 
+//! Energy dependent peak width, shared by all peaks of a fit
+/** The width follows fwhm(E) = sqrt(a + b E + c E^2), where E is related to
+ * the fitter coordinate x by the linear relation E = offset + slope * x. This
+ * allows giving the coefficients in calibrated units, with the calibration
+ * linearized over the fit region. Peaks use the model if they are constructed
+ * without a sigma parameter.
+ */
+class WidthModel {
+  friend class MultiFitter;
+  friend class TheuerkaufFitter;
+
+public:
+  WidthModel() = default;
+  WidthModel(const Param &a, const Param &b, const Param &c, double offset = 0.0, double slope = 1.0)
+      : fA{a}, fB{b}, fC{c}, fOffset{offset}, fSlope{slope} {}
+
+  explicit operator bool() const { return static_cast<bool>(fA); }
+
+  double Sigma(double x, const double *p) const;
+  double SigmaError(double x, const Param &pos, TF1 *func) const;
+  bool IsFree() const { return fA.IsFree() || fB.IsFree() || fC.IsFree(); }
+
+  const Param &GetCoeff(int i) const { return i == 0 ? fA : i == 1 ? fB : fC; }
+
+private:
+  Param fA{Param::Empty()}, fB{Param::Empty()}, fC{Param::Empty()};
+  double fOffset{0.0}, fSlope{1.0};
+  std::vector<std::vector<double>> fCovar; //! Covariance of the last fit
+};
+
 //! ``Theuerkauf'' peak shape, useful for fitting peaks from HPGe detectors
 /** This is the ``standard'' peak shape used by the original ``TV'' program.
  * It is described in appendix B of
@@ -49,6 +81,8 @@ class TheuerkaufFitter;
  * Massengegend um 146Gd (PhD thesis, IKP Cologne, 1994).
  */
 class TheuerkaufPeak {
+  friend class Bootstrap;
+  friend class MultiFitter;
   friend class TheuerkaufFitter;
 
 public:
@@ -74,10 +108,11 @@ public:
 
   void RestoreVol(double value, double error) { RestoreParam(fVol, value, error); }
 
-  double GetSigma() const { return fSigma.Value(fFunc); }
-  double GetSigmaError() const { return fSigma.Error(fFunc); }
-  bool SigmaIsFree() const { return fSigma.IsFree(); }
-  void RestoreSigma(double value, double error) { RestoreParam(fSigma, value, error); }
+  double GetSigma() const;
+  double GetSigmaError() const;
+  bool SigmaIsFree() const { return fWidthModel ? fWidthModel->IsFree() : fSigma.IsFree(); }
+  bool HasWidthModel() const { return fWidthModel != nullptr; }
+  void RestoreSigma(double value, double error);
 
   bool HasLeftTail() const { return fHasLeftTail; }
 
@@ -124,9 +159,26 @@ public:
 
 private:
   double GetNorm(double sigma, double tl, double tr) const;
+  const Param *GetParam(const std::string &name) const;
+  double Sigma(const double *p) const { return fWidthModel ? fWidthModel->Sigma(fPos.Value(p), p) : fSigma.Value(p); }
+
+  //! Peak function for one combination of tails, evaluating the peak and/or
+  //! the step part, without any runtime checks of the peak's features
+  template <bool LeftTail, bool RightTail, bool WithPeak, bool WithStep>
+  double EvalKernel(const double *x, const double *p) const;
+
+  //! Kernels for Eval(), EvalNoStep() and EvalStep(), one set for each of the
+  //! eight tail/step combinations. The set is selected on construction.
+  struct Kernels;
+  template <bool LeftTail, bool RightTail, bool Step> static Kernels MakeKernels();
+  static const Kernels cKernels[8];
+  const Kernels *SelectKernels() const;
 
   Param fPos, fVol, fSigma, fTL, fTR, fSH, fSW;
   bool fHasLeftTail, fHasRightTail, fHasStep;
+  const Kernels *fKernels{cKernels};      //!
+  const WidthModel *fWidthModel{nullptr}; //!
+  double fRestoredSigmaError;
   TF1 *fFunc;
   std::unique_ptr<TF1> fPeakFunc;
 
@@ -139,16 +191,20 @@ private:
 
 //! Fitting multiple TheuerkaufPeaks
 class TheuerkaufFitter : public Fitter {
+  friend class Bootstrap;
+  friend class MultiFitter;
+
 public:
   TheuerkaufFitter(double r1, double r2, Option<bool> integrate, Option<std::string> likelihood,
-                   Option<bool> onlypositivepeaks, bool debugShowInipar = false)
+                   Option<bool> onlypositivepeaks, bool debugShowInipar = false, Option<bool> varpro = false)
       : Fitter(r1, r2), fIntegrate(integrate), fLikelihood(likelihood), fOnlypositivepeaks(onlypositivepeaks),
-        fDebugShowInipar(debugShowInipar) {}
+        fVarPro(varpro), fDebugShowInipar(debugShowInipar) {}
 
   // Copying the fitter is not supported
   TheuerkaufFitter(const TheuerkaufFitter &) = delete;
   TheuerkaufFitter &operator=(const TheuerkaufFitter &) = delete;
 
+  void SetWidthModel(const WidthModel &model);
   void AddPeak(const TheuerkaufPeak &peak);
   void Fit(TH1 &hist, const Background &bg);
   void Fit(TH1 &hist, int intNParams = -1);
@@ -157,6 +213,11 @@ public:
   const TheuerkaufPeak &GetPeak(int i) { return fPeaks[i]; }
   TF1 *GetSumFunc() { return fSumFunc.get(); }
 
+  bool HasWidthModel() const { return static_cast<bool>(fWidthModel); }
+  double GetWidthCoeff(int i) const { return fWidthModel.GetCoeff(i).Value(fSumFunc.get()); }
+  double GetWidthCoeffError(int i) const { return fWidthModel.GetCoeff(i).Error(fSumFunc.get()); }
+  bool WidthCoeffIsFree(int i) const { return fWidthModel.GetCoeff(i).IsFree(); }
+
   TF1 *GetBgFunc();
   bool Restore(const Background &bg, double ChiSquare);
   bool Restore(const TArrayD &bgPolValues, const TArrayD &bgPolErrors, double ChiSquare);
@@ -168,12 +229,16 @@ private:
   double Eval(const double *x, const double *p) const;
   double EvalBg(const double *x, const double *p) const;
   void _Fit(TH1 &hist);
+  void _Init(TH1 &hist);
+  bool _VarProFit(TH1 &hist);
   void _Restore(double ChiSquare);
 
   std::vector<TheuerkaufPeak> fPeaks;
+  WidthModel fWidthModel;
   Option<bool> fIntegrate;
   Option<std::string> fLikelihood;
   Option<bool> fOnlypositivepeaks;
+  Option<bool> fVarPro;
   bool fDebugShowInipar;
 };
 
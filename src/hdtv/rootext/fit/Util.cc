@@ -44,4 +44,10 @@ std::string GetFuncUniqueName(const char *prefix, void *ptr) {
   return name.str();
 }
 
+const double cGaussLegendreNodes[cGaussLegendreOrder] = {-0.9061798459386640, -0.5384693101056831, 0.0,
+                                                         0.5384693101056831, 0.9061798459386640};
+const double cGaussLegendreWeights[cGaussLegendreOrder] = {0.2369268850561891, 0.4786286704993665,
+                                                           0.5688888888888889, 0.4786286704993665,
+                                                           0.2369268850561891};
+
 } // end namespace HDTV
@@ -31,6 +31,12 @@ namespace HDTV {
 
 std::string GetFuncUniqueName(const char *prefix, void *ptr);
 
+//! Nodes and weights of the Gauss-Legendre rule on [-1, 1] used to average
+//! fit functions over a bin
+const int cGaussLegendreOrder = 5;
+extern const double cGaussLegendreNodes[cGaussLegendreOrder];
+extern const double cGaussLegendreWeights[cGaussLegendreOrder];
+
 } // end namespace HDTV
 
 #endif
@@ -0,0 +1,96 @@
+/*
+ * HDTV - A ROOT-based spectrum analysis software
+ *  Copyright (C) 2006-2010  The HDTV development team (see file AUTHORS)
+ *
+ * This file is part of HDTV.
+ *
+ * HDTV is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * HDTV is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HDTV; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ */
+
+#include "LineReadAhead.hh"
+
+#include <utility>
+
+#include "MFileHist.hh"
+
+LineReadAhead::LineReadAhead(MFileHist *matrix, unsigned int level, std::vector<int> lines, std::size_t depth)
+    : fMatrix(matrix), fLevel(level), fLines(std::move(lines)), fDepth(depth), fColumns(matrix->GetNColumns()),
+      fBuf(depth * fColumns), fOk(depth), fProduced(0), fConsumed(0), fStop(false) {
+  fThread = std::thread(&LineReadAhead::Run, this);
+}
+
+LineReadAhead::~LineReadAhead() {
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStop = true;
+  }
+  fCond.notify_all();
+  fThread.join();
+}
+
+void LineReadAhead::Run() {
+  for (std::size_t i = 0; i < fLines.size(); ++i) {
+    {
+      // Wait for a free slot
+      std::unique_lock<std::mutex> lock(fMutex);
+      fCond.wait(lock, [&] { return fStop || i - fConsumed < fDepth; });
+      if (fStop) {
+        return;
+      }
+    }
+
+    const std::size_t slot = i % fDepth;
+    bool ok = fMatrix->FillBuf1D(&fBuf[slot * fColumns], fLevel, fLines[i]) != nullptr;
+
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fOk[slot] = ok;
+      fProduced = i + 1;
+    }
+    fCond.notify_all();
+
+    if (!ok) {
+      return;
+    }
+  }
+}
+
+bool LineReadAhead::AddNext(TArrayD &dst) {
+  const std::size_t slot = fConsumed % fDepth;
+
+  {
+    std::unique_lock<std::mutex> lock(fMutex);
+    fCond.wait(lock, [&] { return fProduced > fConsumed; });
+    if (!fOk[slot]) {
+      return false;
+    }
+  }
+
+  // The slot is not touched by the reader until it is released below
+  const double *src = &fBuf[slot * fColumns];
+  double *d = dst.GetArray();
+  for (std::size_t c = 0; c < fColumns; ++c) {
+    d[c] += src[c];
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    ++fConsumed;
+  }
+  fCond.notify_all();
+
+  return true;
+}
@@ -0,0 +1,78 @@
+/*
+ * HDTV - A ROOT-based spectrum analysis software
+ *  Copyright (C) 2006-2010  The HDTV development team (see file AUTHORS)
+ *
+ * This file is part of HDTV.
+ *
+ * HDTV is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * HDTV is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HDTV; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ */
+
+#ifndef __LineReadAhead_h__
+#define __LineReadAhead_h__
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <TArrayD.h>
+
+class MFileHist;
+
+//! Reads a fixed sequence of matrix lines in a background thread
+/*!
+ * Lines are decoded into a bounded ring buffer of depth slots ahead of the
+ * consumer, so that summing up the lines of a cut does not stall on disk
+ * latency for every single line. While the reader is active, it is the only
+ * user of the MFileHist.
+ */
+class LineReadAhead {
+public:
+  LineReadAhead(MFileHist *matrix, unsigned int level, std::vector<int> lines, std::size_t depth);
+  ~LineReadAhead();
+
+  LineReadAhead(const LineReadAhead &) = delete;
+  LineReadAhead &operator=(const LineReadAhead &) = delete;
+
+  //! Check whether line l is the next one in the sequence
+  bool Expects(int l) const { return fConsumed < fLines.size() && fLines[fConsumed] == l; }
+
+  //! Add the next line of the sequence to dst, waiting for it if necessary.
+  //! Returns false if the line could not be read.
+  bool AddNext(TArrayD &dst);
+
+private:
+  void Run();
+
+  MFileHist *fMatrix;
+  unsigned int fLevel;
+  std::vector<int> fLines;
+  std::size_t fDepth, fColumns;
+
+  // Slot i % fDepth holds line fLines[i]
+  std::vector<double> fBuf;
+  std::vector<char> fOk;
+
+  // fConsumed is only written by the consumer, fProduced by the reader
+  std::size_t fProduced, fConsumed;
+  bool fStop;
+  std::mutex fMutex;
+  std::condition_variable fCond;
+  std::thread fThread;
+};
+
+#endif
@@ -21,6 +21,7 @@
  */
 #include "MFileHist.hh"
 
+#include <algorithm>
 #include <iostream>
 
 #include <TArrayD.h>
@@ -278,19 +279,36 @@ TH1I *MFileHist::ToTH1I(const char *name, const char *title, unsigned int level,
   return ToTH1<TH1I>(name, title, level, line);
 }
 
+bool MFileHist::IsTriangular() {
+  switch (GetFileType()) {
+  case MAT_LE2T:
+  case MAT_LE4T:
+  case MAT_HE2T:
+  case MAT_HE4T:
+    return true;
+  default:
+    return false;
+  }
+}
+
 double *MFileHist::FillBuf1D(double *buf, unsigned int level, unsigned int line) {
+  return FillBuf1D(buf, level, line, 0, GetNColumns());
+}
+
+//! Read columns col ... col+num-1 of a line
+double *MFileHist::FillBuf1D(double *buf, unsigned int level, unsigned int line, unsigned int col, unsigned int num) {
   if (!fHist || !fInfo) {
     fErrno = ERR_READ_NOTOPEN;
     return nullptr;
   }
 
-  if (level >= fInfo->levels || line >= fInfo->lines) {
+  if (level >= fInfo->levels || line >= fInfo->lines || col + num > fInfo->columns) {
     fErrno = ERR_READ_BADIDX;
     return nullptr;
   }
 
-  int rc = mgetdbl(fHist, buf, level, line, 0, fInfo->columns);
-  if (rc < 0 || static_cast<unsigned int>(rc) != fInfo->columns) {
+  int rc = mgetdbl(fHist, buf, level, line, col, num);
+  if (rc < 0 || static_cast<unsigned int>(rc) != num) {
     fErrno = ERR_READ_GET;
     return nullptr;
   }
@@ -299,9 +317,43 @@ double *MFileHist::FillBuf1D(double *buf, unsigned int level, unsigned int line)
   return buf;
 }
 
-TH2 *MFileHist::FillTH2(TH2 *hist, unsigned int level) {
-  unsigned int line, col;
+namespace {
+int mgetline(MFILE *mf, double *buf, unsigned int level, unsigned int line, unsigned int num) {
+  return mgetdbl(mf, buf, level, line, 0, num);
+}
 
+int mgetline(MFILE *mf, float *buf, unsigned int level, unsigned int line, unsigned int num) {
+  return mgetflt(mf, buf, level, line, 0, num);
+}
+
+int mgetline(MFILE *mf, int32_t *buf, unsigned int level, unsigned int line, unsigned int num) {
+  return mgetint(mf, buf, level, line, 0, num);
+}
+
+//! Read all lines of a matrix straight into the bin array of a TH2 whose
+//! binning matches the matrix, without any intermediate buffer
+template <typename T>
+bool StreamTH2(MFILE *mf, TH2 *hist, T *arr, unsigned int level, unsigned int lines, unsigned int cols, bool tri) {
+  for (unsigned int line = 0; line < lines; line++) {
+    // Bins (1, line+1) ... (cols, line+1) are contiguous in memory
+    T *dst = arr + hist->GetBin(1, line + 1);
+    int rc = mgetline(mf, dst, level, line, cols);
+    if (rc < 0 || static_cast<unsigned int>(rc) != cols) {
+      return false;
+    }
+
+    // Mirror the lower triangle of a symmetric matrix
+    if (tri) {
+      for (unsigned int col = 0; col < line; col++) {
+        arr[hist->GetBin(line + 1, col + 1)] = dst[col];
+      }
+    }
+  }
+  return true;
+}
+} // end anonymous namespace
+
+TH2 *MFileHist::FillTH2(TH2 *hist, unsigned int level) {
   if (!fHist || !fInfo) {
     fErrno = ERR_READ_NOTOPEN;
     return nullptr;
@@ -312,20 +364,60 @@ TH2 *MFileHist::FillTH2(TH2 *hist, unsigned int level) {
     return nullptr;
   }
 
-  TArrayD buf(fInfo->columns);
+  const unsigned int lines = fInfo->lines;
+  const unsigned int cols = fInfo->columns;
+  const bool tri = IsTriangular();
+
+  // Fast path: one bin per matrix cell and no bin errors to keep up to date
+  if (static_cast<unsigned int>(hist->GetNbinsX()) == cols && static_cast<unsigned int>(hist->GetNbinsY()) == lines &&
+      hist->GetSumw2N() == 0) {
+    bool streamed = true;
+    bool ok = false;
+    if (auto h = dynamic_cast<TH2D *>(hist)) {
+      ok = StreamTH2(fHist, hist, h->GetArray(), level, lines, cols, tri);
+    } else if (auto h = dynamic_cast<TH2F *>(hist)) {
+      ok = StreamTH2(fHist, hist, h->GetArray(), level, lines, cols, tri);
+    } else if (auto h = dynamic_cast<TH2I *>(hist)) {
+      ok = StreamTH2(fHist, hist, h->GetArray(), level, lines, cols, tri);
+    } else {
+      streamed = false;
+    }
+
+    if (streamed) {
+      if (!ok) {
+        fErrno = ERR_READ_GET;
+        return nullptr;
+      }
+      // Bin contents changed behind the histogram's back
+      hist->ResetStats();
+      hist->SetEntries(static_cast<double>(lines) * cols);
+      fErrno = ERR_SUCCESS;
+      return hist;
+    }
+  }
 
-  for (line = 0; line < fInfo->lines; line++) {
-    int rc = mgetdbl(fHist, buf.GetArray(), level, line, 0, fInfo->columns);
-    if (rc < 0 || static_cast<unsigned int>(rc) != fInfo->columns) {
+  unsigned int line, col;
+  TArrayD buf(cols);
+
+  for (line = 0; line < lines; line++) {
+    int rc = mgetdbl(fHist, buf.GetArray(), level, line, 0, cols);
+    if (rc < 0 || static_cast<unsigned int>(rc) != cols) {
       break;
     }
 
-    for (col = 0; col < fInfo->columns; col++) {
+    for (col = 0; col < cols; col++) {
       hist->SetBinContent(col + 1, line + 1, buf[col]);
     }
+
+    // Mirror the lower triangle of a symmetric matrix
+    if (tri) {
+      for (col = 0; col < line; col++) {
+        hist->SetBinContent(line + 1, col + 1, buf[col]);
+      }
+    }
   }
 
-  if (line != fInfo->lines) {
+  if (line != lines) {
     fErrno = ERR_READ_GET;
     return nullptr;
   }
@@ -334,6 +426,96 @@ TH2 *MFileHist::FillTH2(TH2 *hist, unsigned int level) {
   return hist;
 }
 
+//! Fill a TH2 from a window of the matrix, summing rebinX x rebinY cells into
+//! one bin. Bin (1, 1) of hist receives the cells starting at (col1, line1);
+//! the size of the window is given by the number of bins of hist. Only one
+//! line of the window is buffered at a time.
+TH2 *MFileHist::FillTH2(TH2 *hist, unsigned int level, unsigned int col1, unsigned int line1, unsigned int rebinX,
+                        unsigned int rebinY) {
+  if (!fHist || !fInfo) {
+    fErrno = ERR_READ_NOTOPEN;
+    return nullptr;
+  }
+
+  if (rebinX == 0 || rebinY == 0) {
+    fErrno = ERR_READ_BADIDX;
+    return nullptr;
+  }
+
+  const unsigned int nbinsX = hist->GetNbinsX();
+  const unsigned int nbinsY = hist->GetNbinsY();
+  const unsigned int col2 = col1 + nbinsX * rebinX - 1;
+  const unsigned int line2 = line1 + nbinsY * rebinY - 1;
+  if (level >= fInfo->levels || col2 >= fInfo->columns || line2 >= fInfo->lines) {
+    fErrno = ERR_READ_BADIDX;
+    return nullptr;
+  }
+
+  if (col1 == 0 && line1 == 0 && rebinX == 1 && rebinY == 1 && nbinsX == fInfo->columns && nbinsY == fInfo->lines) {
+    return FillTH2(hist, level);
+  }
+
+  hist->Reset();
+
+  if (!IsTriangular()) {
+    const unsigned int num = col2 - col1 + 1;
+    TArrayD buf(num);
+    TArrayD row(nbinsX);
+    for (unsigned int by = 0; by < nbinsY; by++) {
+      row.Reset(0.0);
+      for (unsigned int line = line1 + by * rebinY; line < line1 + (by + 1) * rebinY; line++) {
+        int rc = mgetdbl(fHist, buf.GetArray(), level, line, col1, num);
+        if (rc < 0 || static_cast<unsigned int>(rc) != num) {
+          fErrno = ERR_READ_GET;
+          return nullptr;
+        }
+        for (unsigned int i = 0; i < num; i++) {
+          row[i / rebinX] += buf[i];
+        }
+      }
+      for (unsigned int bx = 0; bx < nbinsX; bx++) {
+        hist->SetBinContent(bx + 1, by + 1, row[bx]);
+      }
+    }
+  } else {
+    // Only the lower triangle T(l, c), c <= l, is stored. Cells of the window
+    // on or below the diagonal are M(l, c) = T(l, c), read from the lines
+    // line1 ... line2. Cells above it are M(l, c) = T(c, l), read from the
+    // lines col1 ... col2. Only the parts of these lines inside the window
+    // are read.
+    TArrayD buf(std::max(col2 - col1, line2 - line1) + 1);
+    auto read = [&](unsigned int l, unsigned int c, unsigned int num) {
+      int rc = mgetdbl(fHist, buf.GetArray(), level, l, c, num);
+      return rc >= 0 && static_cast<unsigned int>(rc) == num;
+    };
+    for (unsigned int l = std::max(line1, col1); l <= line2; l++) {
+      const unsigned int num = std::min(col2, l) - col1 + 1;
+      if (!read(l, col1, num)) {
+        fErrno = ERR_READ_GET;
+        return nullptr;
+      }
+      for (unsigned int i = 0; i < num; i++) {
+        hist->AddBinContent(hist->GetBin(i / rebinX + 1, (l - line1) / rebinY + 1), buf[i]);
+      }
+    }
+    for (unsigned int l = std::max(col1, line1 + 1); l <= col2; l++) {
+      const unsigned int num = std::min(line2, l - 1) - line1 + 1;
+      if (!read(l, line1, num)) {
+        fErrno = ERR_READ_GET;
+        return nullptr;
+      }
+      for (unsigned int i = 0; i < num; i++) {
+        hist->AddBinContent(hist->GetBin((l - col1) / rebinX + 1, i / rebinY + 1), buf[i]);
+      }
+    }
+  }
+
+  hist->ResetStats();
+  hist->SetEntries(static_cast<double>(nbinsX) * nbinsY);
+  fErrno = ERR_SUCCESS;
+  return hist;
+}
+
 template <class histType> histType *MFileHist::ToTH2(const char *name, const char *title, unsigned int level) {
   histType *hist;
 
@@ -358,6 +540,45 @@ template <class histType> histType *MFileHist::ToTH2(const char *name, const cha
   return hist;
 }
 
+//! Load the window col1 ... col2, line1 ... line2 (inclusive) of the matrix,
+//! rebinned by rebinX and rebinY. Channels at the upper end of the window that
+//! do not fill a whole bin are dropped, as with TH1::Rebin().
+template <class histType>
+histType *MFileHist::ToTH2(const char *name, const char *title, unsigned int level, unsigned int col1,
+                           unsigned int col2, unsigned int line1, unsigned int line2, unsigned int rebinX,
+                           unsigned int rebinY) {
+  histType *hist;
+
+  if (!fHist || !fInfo) {
+    fErrno = ERR_READ_NOTOPEN;
+    return nullptr;
+  }
+
+  if (level >= fInfo->levels || col1 > col2 || line1 > line2 || col2 >= fInfo->columns || line2 >= fInfo->lines ||
+      rebinX == 0 || rebinY == 0) {
+    fErrno = ERR_READ_BADIDX;
+    return nullptr;
+  }
+
+  const unsigned int nbinsX = (col2 - col1 + 1) / rebinX;
+  const unsigned int nbinsY = (line2 - line1 + 1) / rebinY;
+  if (nbinsX == 0 || nbinsY == 0) {
+    fErrno = ERR_READ_BADIDX;
+    return nullptr;
+  }
+
+  hist = new histType(name, title, nbinsX, col1 - 0.5, col1 + nbinsX * rebinX - 0.5, nbinsY, line1 - 0.5,
+                      line1 + nbinsY * rebinY - 0.5);
+
+  // FillTH2 will set fErrno
+  if (!FillTH2(hist, level, col1, line1, rebinX, rebinY)) {
+    delete hist;
+    return nullptr;
+  }
+
+  return hist;
+}
+
 TH2D *MFileHist::ToTH2D(const char *name, const char *title, unsigned int level) {
   return ToTH2<TH2D>(name, title, level);
 }
@@ -365,3 +586,13 @@ TH2D *MFileHist::ToTH2D(const char *name, const char *title, unsigned int level)
 TH2I *MFileHist::ToTH2I(const char *name, const char *title, unsigned int level) {
   return ToTH2<TH2I>(name, title, level);
 }
+
+TH2D *MFileHist::ToTH2D(const char *name, const char *title, unsigned int level, unsigned int col1, unsigned int col2,
+                        unsigned int line1, unsigned int line2, unsigned int rebinX, unsigned int rebinY) {
+  return ToTH2<TH2D>(name, title, level, col1, col2, line1, line2, rebinX, rebinY);
+}
+
+TH2I *MFileHist::ToTH2I(const char *name, const char *title, unsigned int level, unsigned int col1, unsigned int col2,
+                        unsigned int line1, unsigned int line2, unsigned int rebinX, unsigned int rebinY) {
+  return ToTH2<TH2I>(name, title, level, col1, col2, line1, line2, rebinX, rebinY);
+}
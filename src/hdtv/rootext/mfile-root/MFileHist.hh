@@ -49,7 +49,11 @@ public:
   unsigned int GetNLines() { return fInfo ? fInfo->lines : 0; }
   unsigned int GetNColumns() { return fInfo ? fInfo->columns : 0; }
 
+  //! Symmetric matrix of which only the lower triangle (col <= line) is stored
+  bool IsTriangular();
+
   double *FillBuf1D(double *buf, unsigned int level, unsigned int line);
+  double *FillBuf1D(double *buf, unsigned int level, unsigned int line, unsigned int col, unsigned int num);
 
   template <class histType> histType *ToTH1(const char *name, const char *title, unsigned int level, unsigned int line);
 
@@ -59,11 +63,20 @@ public:
   TH1I *ToTH1I(const char *name, const char *title, unsigned int level, unsigned int line);
 
   template <class histType> histType *ToTH2(const char *name, const char *title, unsigned int level);
+  template <class histType>
+  histType *ToTH2(const char *name, const char *title, unsigned int level, unsigned int col1, unsigned int col2,
+                  unsigned int line1, unsigned int line2, unsigned int rebinX = 1, unsigned int rebinY = 1);
 
   TH2 *FillTH2(TH2 *hist, unsigned int level);
+  TH2 *FillTH2(TH2 *hist, unsigned int level, unsigned int col1, unsigned int line1, unsigned int rebinX,
+               unsigned int rebinY);
 
   TH2D *ToTH2D(const char *name, const char *title, unsigned int level);
   TH2I *ToTH2I(const char *name, const char *title, unsigned int level);
+  TH2D *ToTH2D(const char *name, const char *title, unsigned int level, unsigned int col1, unsigned int col2,
+               unsigned int line1, unsigned int line2, unsigned int rebinX = 1, unsigned int rebinY = 1);
+  TH2I *ToTH2I(const char *name, const char *title, unsigned int level, unsigned int col1, unsigned int col2,
+               unsigned int line1, unsigned int line2, unsigned int rebinX = 1, unsigned int rebinY = 1);
 
   static int WriteTH1(const TH1 *hist, char *fname, char *fmt);
   static int WriteTH2(const TH2 *hist, char *fname, char *fmt);
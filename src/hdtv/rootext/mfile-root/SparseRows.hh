@@ -0,0 +1,94 @@
+/*
+ * HDTV - A ROOT-based spectrum analysis software
+ *  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+ *
+ * This file is part of HDTV.
+ *
+ * HDTV is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * HDTV is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HDTV; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ */
+
+#ifndef __SparseRows_h__
+#define __SparseRows_h__
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+//! Non-empty bins of a matrix in compressed sparse row (CSR) format
+/*!
+ * Rows and columns are numbered as ROOT bins, i.e. 1 ... N. Row r occupies
+ * the entries GetRowBegin(r) ... GetRowEnd(r)-1 of GetColumns() and
+ * GetContents(), sorted by column, so that a bin can be found with a binary
+ * search within its row.
+ */
+class SparseRows {
+public:
+  //! Fill the rows. visit(add) must call add(row, column, content) once for
+  //! every non-empty bin; it is invoked twice, once for counting and once for
+  //! filling.
+  template <typename Visitor> void Build(int rows, Visitor visit) {
+    // First pass: count entries per row, then convert to row end offsets
+    fRowStart.assign(rows + 1, 0);
+    visit([&](int r, int, double) { ++fRowStart[r]; });
+    std::partial_sum(fRowStart.begin(), fRowStart.end(), fRowStart.begin());
+
+    // Second pass: scatter entries into their rows
+    fColumn.resize(fRowStart.back());
+    fContent.resize(fRowStart.back());
+    std::vector<std::size_t> next(fRowStart.begin(), fRowStart.end() - 1);
+    visit([&](int r, int c, double z) {
+      std::size_t i = next[r - 1]++;
+      fColumn[i] = c;
+      fContent[i] = z;
+    });
+
+    // Sources like THnSparse do not store their bins in any particular order
+    std::vector<std::pair<int, double>> tmp;
+    for (int r = 0; r < rows; ++r) {
+      const std::size_t begin = fRowStart[r], end = fRowStart[r + 1];
+      if (std::is_sorted(fColumn.begin() + begin, fColumn.begin() + end)) {
+        continue;
+      }
+      tmp.clear();
+      for (std::size_t i = begin; i < end; ++i) {
+        tmp.emplace_back(fColumn[i], fContent[i]);
+      }
+      std::sort(tmp.begin(), tmp.end());
+      for (std::size_t i = begin; i < end; ++i) {
+        fColumn[i] = tmp[i - begin].first;
+        fContent[i] = tmp[i - begin].second;
+      }
+    }
+  }
+
+  std::size_t GetRowBegin(int row) const { return fRowStart[row - 1]; }
+  std::size_t GetRowEnd(int row) const { return fRowStart[row]; }
+
+  const std::vector<int> &GetColumns() const { return fColumn; }
+  const std::vector<double> &GetContents() const { return fContent; }
+
+  //! Number of non-empty bins stored
+  std::size_t GetNFilled() const { return fContent.size(); }
+
+private:
+  std::vector<std::size_t> fRowStart;
+  std::vector<int> fColumn;
+  std::vector<double> fContent;
+};
+
+#endif
@@ -22,7 +22,10 @@
 
 #include "VMatrix.hh"
 
+#include <algorithm>
 #include <cmath>
+#include <iterator>
+#include <utility>
 
 #include <TArrayD.h>
 
@@ -65,8 +68,16 @@ void VMatrix::AddRegion(std::list<int> &reglist, int l1, int l2) {
 
 class ReadException {};
 
+//! Add up lines l1 ... l2. Implementations may override this to read
+//! strips of the matrix instead of single lines.
+void VMatrix::AddLines(TArrayD &dst, int l1, int l2) {
+  for (int l = l1; l <= l2; l++) {
+    AddLine(dst, l);
+  }
+}
+
 TH1 *VMatrix::Cut(const char *histname, const char *histtitle) {
-  int l, l1, l2; // lines
+  int l1, l2; // lines
   std::list<int>::iterator iter;
   int nCut = 0, nBg = 0; // total number of cut and background lines
   int pbins = GetProjXbins();
@@ -87,16 +98,28 @@ TH1 *VMatrix::Cut(const char *histname, const char *histtitle) {
   TArrayD bg(pbins);
   bg.Reset(0.0);
 
+  // Tell the implementation which lines are coming
+  std::vector<int> lines;
+  for (auto regions : {&fCutRegions, &fBgRegions}) {
+    iter = regions->begin();
+    while (iter != regions->end()) {
+      l1 = *iter++;
+      l2 = *iter++;
+      for (int l = l1; l <= l2; l++) {
+        lines.push_back(l);
+      }
+    }
+  }
+  PrepareLines(lines);
+
   try {
     // Add up all cut lines
     iter = fCutRegions.begin();
     while (iter != fCutRegions.end()) {
       l1 = *iter++;
       l2 = *iter++;
-      for (l = l1; l <= l2; l++) {
-        AddLine(sum, l);
-        nCut++;
-      }
+      AddLines(sum, l1, l2);
+      nCut += l2 - l1 + 1;
     }
 
     // Add up all background lines
@@ -104,14 +127,14 @@ TH1 *VMatrix::Cut(const char *histname, const char *histtitle) {
     while (iter != fBgRegions.end()) {
       l1 = *iter++;
       l2 = *iter++;
-      for (l = l1; l <= l2; l++) {
-        AddLine(bg, l);
-        nBg++;
-      }
+      AddLines(bg, l1, l2);
+      nBg += l2 - l1 + 1;
     }
   } catch (ReadException &) {
+    FinishLines();
     return nullptr;
   }
+  FinishLines();
 
   double bgFac = (nBg == 0) ? 0.0 : static_cast<double>(nCut) / nBg;
   auto hist = new TH1D(histname, histtitle, GetProjXbins(), GetProjXmin(), GetProjXmax());
@@ -143,7 +166,15 @@ void RMatrix::AddLine(TArrayD &dst, int l) {
   }
 }
 
-MFMatrix::MFMatrix(MFileHist *mat, unsigned int level) : VMatrix(), fMatrix(mat), fLevel(level), fBuf() {
+// Needed when bound to a reference, as by std::make_unique (before C++17)
+const std::size_t MFMatrix::cReadAheadDepth;
+const std::size_t MFMatrix::cColumnCacheSize;
+
+MFMatrix::MFMatrix(MFileHist *mat, unsigned int level, bool columns)
+    : VMatrix(), fMatrix(mat), fLevel(level), fSymmetric(mat->IsTriangular()), fBuf() {
+  // Column cuts of a symmetric matrix are just line cuts
+  fColumns = columns && !fSymmetric;
+
   // Sanity checks
   if (fLevel >= fMatrix->GetNLevels()) {
     fFail = true;
@@ -152,7 +183,130 @@ MFMatrix::MFMatrix(MFileHist *mat, unsigned int level) : VMatrix(), fMatrix(mat)
   }
 }
 
+MFMatrix::~MFMatrix() = default;
+
+//! Start reading the given lines in the background. Symmetric matrices are
+//! read in strips (see AddLines()) and do not use the read-ahead. For column
+//! cuts, all requested columns are fetched into the cache in one pass.
+void MFMatrix::PrepareLines(const std::vector<int> &lines) {
+  fReadAhead.reset();
+  if (fColumns) {
+    // Read errors are reported by AddLine()
+    if (!Failed()) {
+      LoadColumns(lines);
+    }
+    return;
+  }
+  if (!fSymmetric && !Failed() && lines.size() > 1) {
+    fReadAhead = std::make_unique<LineReadAhead>(fMatrix, fLevel, lines, cReadAheadDepth);
+  }
+}
+
+void MFMatrix::FinishLines() { fReadAhead.reset(); }
+
+//! Read the given columns of all lines into the column cache. Contiguous
+//! columns are read as one strip per line, and the lines are visited in
+//! order, so this is a single sequential scan of the matrix.
+bool MFMatrix::LoadColumns(std::vector<int> cols) {
+  int ncols = fMatrix->GetNColumns();
+  int lines = fMatrix->GetNLines();
+
+  std::sort(cols.begin(), cols.end());
+  cols.erase(std::unique(cols.begin(), cols.end()), cols.end());
+  cols.erase(std::remove_if(cols.begin(), cols.end(), [ncols](int c) { return c < 0 || c >= ncols; }), cols.end());
+
+  std::vector<int> missing;
+  std::copy_if(cols.begin(), cols.end(), std::back_inserter(missing),
+               [this](int c) { return fColumnCache.find(c) == fColumnCache.end(); });
+  if (missing.empty()) {
+    return true;
+  }
+
+  // Keep only the columns needed now if the cache would grow too large
+  if ((fColumnCache.size() + missing.size()) * lines * sizeof(double) > cColumnCacheSize) {
+    for (auto it = fColumnCache.begin(); it != fColumnCache.end();) {
+      if (std::binary_search(cols.begin(), cols.end(), it->first)) {
+        ++it;
+      } else {
+        it = fColumnCache.erase(it);
+      }
+    }
+  }
+
+  // Runs of contiguous columns, as (first column, length)
+  std::vector<std::pair<int, int>> runs;
+  for (int c : missing) {
+    if (!runs.empty() && runs.back().first + runs.back().second == c) {
+      ++runs.back().second;
+    } else {
+      runs.emplace_back(c, 1);
+    }
+  }
+
+  std::vector<std::vector<double> *> dst;
+  for (int c : missing) {
+    auto &col = fColumnCache[c];
+    col.resize(lines);
+    dst.push_back(&col);
+  }
+
+  double *buf = fBuf.GetArray();
+  for (int l = 0; l < lines; ++l) {
+    auto d = dst.begin();
+    for (const auto &run : runs) {
+      if (!fMatrix->FillBuf1D(buf, fLevel, l, run.first, run.second)) {
+        for (int c : missing) {
+          fColumnCache.erase(c);
+        }
+        return false;
+      }
+      for (int i = 0; i < run.second; ++i) {
+        (**d++)[l] = buf[i];
+      }
+    }
+  }
+
+  return true;
+}
+
 void MFMatrix::AddLine(TArrayD &dst, int l) {
+  if (fSymmetric) {
+    AddLines(dst, l, l);
+    return;
+  }
+
+  if (fColumns) {
+    auto it = fColumnCache.find(l);
+    if (it == fColumnCache.end()) {
+      if (!LoadColumns({l})) {
+        throw ReadException();
+      }
+      it = fColumnCache.find(l);
+    }
+    if (it == fColumnCache.end()) {
+      // Column out of range
+      throw ReadException();
+    }
+
+    const auto &col = it->second;
+    double *d = dst.GetArray();
+    for (std::size_t k = 0; k < col.size(); ++k) {
+      d[k] += col[k];
+    }
+    return;
+  }
+
+  if (fReadAhead) {
+    if (fReadAhead->Expects(l)) {
+      if (!fReadAhead->AddNext(dst)) {
+        throw ReadException();
+      }
+      return;
+    }
+    // Out of sequence: stop the reader and fall back to direct reads
+    fReadAhead.reset();
+  }
+
   if (!fMatrix->FillBuf1D(fBuf.GetArray(), fLevel, l)) {
     throw ReadException();
   }
@@ -164,3 +318,117 @@ void MFMatrix::AddLine(TArrayD &dst, int l) {
     dst[c] += fBuf[c];
   }
 }
+
+void MFMatrix::AddLines(TArrayD &dst, int l1, int l2) {
+  if (!fSymmetric) {
+    VMatrix::AddLines(dst, l1, l2);
+    return;
+  }
+
+  // Only the lower triangle T(l, c), c <= l, of the symmetric matrix M is
+  // stored, so M(l, c) = T(max(l, c), min(l, c)).
+  double *buf = fBuf.GetArray();
+  double *d = dst.GetArray();
+  int lines = fMatrix->GetNLines();
+
+  // Columns c <= l: first l+1 entries of line l
+  for (int l = l1; l <= l2; ++l) {
+    if (!fMatrix->FillBuf1D(buf, fLevel, l, 0, l + 1)) {
+      throw ReadException();
+    }
+    for (int c = 0; c <= l; ++c) {
+      d[c] += buf[c];
+    }
+  }
+
+  // Columns c > l: the strip l1 ... min(l2, c-1) of line c
+  for (int c = l1 + 1; c < lines; ++c) {
+    int num = std::min(l2, c - 1) - l1 + 1;
+    if (!fMatrix->FillBuf1D(buf, fLevel, c, l1, num)) {
+      throw ReadException();
+    }
+    for (int i = 0; i < num; ++i) {
+      d[c] += buf[i];
+    }
+  }
+}
+
+SparseMatrix::SparseMatrix(THnSparse *hist, ProjAxis_t paxis) : VMatrix() {
+  if (hist->GetNdimensions() != 2) {
+    fFail = true;
+    return;
+  }
+
+  const int cutDim = (paxis == PROJ_X) ? 1 : 0;
+  const int projDim = 1 - cutDim;
+  fCutAxis = *hist->GetAxis(cutDim);
+  fProjAxis = *hist->GetAxis(projDim);
+
+  const int lines = fCutAxis.GetNbins();
+  const int cols = fProjAxis.GetNbins();
+  fLines.Build(lines, [&](auto add) {
+    Int_t coord[2];
+    for (Long64_t i = 0; i < hist->GetNbins(); ++i) {
+      double z = hist->GetBinContent(i, coord);
+      int l = coord[cutDim];
+      int c = coord[projDim];
+      if (z != 0.0 && l >= 1 && l <= lines && c >= 1 && c <= cols) {
+        add(l, c, z);
+      }
+    }
+  });
+}
+
+SparseMatrix::SparseMatrix(TH2 *hist, ProjAxis_t paxis) : VMatrix() {
+  fCutAxis = (paxis == PROJ_X) ? *hist->GetYaxis() : *hist->GetXaxis();
+  fProjAxis = (paxis == PROJ_X) ? *hist->GetXaxis() : *hist->GetYaxis();
+
+  const int lines = fCutAxis.GetNbins();
+  const int cols = fProjAxis.GetNbins();
+  fLines.Build(lines, [&](auto add) {
+    for (int l = 1; l <= lines; ++l) {
+      for (int c = 1; c <= cols; ++c) {
+        double z = (paxis == PROJ_X) ? hist->GetBinContent(c, l) : hist->GetBinContent(l, c);
+        if (z != 0.0) {
+          add(l, c, z);
+        }
+      }
+    }
+  });
+}
+
+void SparseMatrix::AddLine(TArrayD &dst, int l) {
+  if (l < 1 || l > fCutAxis.GetNbins()) {
+    return;
+  }
+
+  double *d = dst.GetArray();
+  const auto &columns = fLines.GetColumns();
+  const auto &contents = fLines.GetContents();
+  for (std::size_t i = fLines.GetRowBegin(l); i < fLines.GetRowEnd(l); ++i) {
+    d[columns[i] - 1] += contents[i];
+  }
+}
+
+//! Projection onto the projection axis, i.e. the sum over all lines
+TH1 *SparseMatrix::Projection(const char *histname, const char *histtitle) {
+  if (Failed()) {
+    return nullptr;
+  }
+
+  const int pbins = GetProjXbins();
+  TArrayD sum(pbins);
+  sum.Reset(0.0);
+  const auto &columns = fLines.GetColumns();
+  const auto &contents = fLines.GetContents();
+  for (std::size_t i = 0; i < contents.size(); ++i) {
+    sum[columns[i] - 1] += contents[i];
+  }
+
+  auto hist = new TH1D(histname, histtitle, pbins, GetProjXmin(), GetProjXmax());
+  for (int c = 0; c < pbins; c++) {
+    hist->SetBinContent(c + 1, sum[c]);
+  }
+
+  return hist;
+}
@@ -24,12 +24,20 @@
 #define __VMatrix_h__
 
 #include <cmath>
+#include <cstdint>
 #include <list>
+#include <map>
+#include <memory>
+#include <vector>
 
+#include <TAxis.h>
 #include <TH1.h>
 #include <TH2.h>
+#include <THnSparse.h>
 
+#include "LineReadAhead.hh"
 #include "MFileHist.hh"
+#include "SparseRows.hh"
 
 // VMatrix and RMatrix should be moved to a different module, as they are not
 // related to MFile...
@@ -74,6 +82,15 @@ public:
   virtual int GetProjXbins() = 0;
 
   virtual void AddLine(TArrayD &dst, int l) = 0;
+  virtual void AddLines(TArrayD &dst, int l1, int l2);
+
+  //! Announce the lines that the following AddLine() calls will ask for, in
+  //! that order, so that implementations may read ahead
+  virtual void PrepareLines(const std::vector<int> &lines) {}
+  virtual void FinishLines() {}
+
+  //! Cuts on either axis give the same result
+  virtual bool IsSymmetric() { return false; }
 
   bool Failed() { return fFail; }
 
@@ -121,10 +138,21 @@ private:
 };
 
 //! MFile-histogram-backed VMatrix
+/*!
+ * Symmetric matrices stored as a triangle (le2t, le4t, ...) are supported:
+ * only the triangle is ever read, and full lines are reconstructed on the
+ * fly, so a cut may be placed on either axis.
+ *
+ * With columns = true, the cut is placed on the columns of the matrix and
+ * projected onto the lines, which saves writing a transposed copy of an
+ * asymmetric matrix. The requested columns are collected in a single scan
+ * over all lines and kept in a cache, so that moving the background regions
+ * only reads the columns not seen before.
+ */
 class MFMatrix : public VMatrix {
 public:
-  MFMatrix(MFileHist *mat, unsigned int level);
-  ~MFMatrix() override = default;
+  MFMatrix(MFileHist *mat, unsigned int level, bool columns = false);
+  ~MFMatrix() override;
 
   int FindCutBin(double x) override // convert channel to bin number
   {
@@ -132,18 +160,75 @@ public:
   }
 
   int GetCutLowBin() override { return 0; }
-  int GetCutHighBin() override { return fMatrix->GetNLines() - 1; }
+  int GetCutHighBin() override { return (fColumns ? fMatrix->GetNColumns() : fMatrix->GetNLines()) - 1; }
 
   double GetProjXmin() override { return -0.5; }
-  double GetProjXmax() override { return fMatrix->GetNColumns() - .5; }
-  int GetProjXbins() override { return fMatrix->GetNColumns(); }
+  double GetProjXmax() override { return GetProjXbins() - .5; }
+  int GetProjXbins() override { return fColumns ? fMatrix->GetNLines() : fMatrix->GetNColumns(); }
 
   void AddLine(TArrayD &dst, int l) override;
+  void AddLines(TArrayD &dst, int l1, int l2) override;
+
+  void PrepareLines(const std::vector<int> &lines) override;
+  void FinishLines() override;
+
+  bool IsSymmetric() override { return fSymmetric; }
+
+  //! Cuts are placed on the columns of the matrix
+  bool IsColumnCut() { return fColumns; }
 
 private:
+  bool LoadColumns(std::vector<int> cols);
+
+  static const std::size_t cReadAheadDepth = 32;
+  static const std::size_t cColumnCacheSize = 64 * 1024 * 1024; // bytes
+
   MFileHist *fMatrix;
   unsigned int fLevel;
+  bool fSymmetric;
+  bool fColumns;
   TArrayD fBuf;
+  std::unique_ptr<LineReadAhead> fReadAhead;        //!
+  std::map<int, std::vector<double>> fColumnCache; //!
+};
+
+//! Sparse VMatrix, storing only non-empty bins in compressed sparse row (CSR)
+//! format
+/*!
+ * Each line of the cut axis is stored as a list of (column, content) pairs,
+ * so memory usage scales with the number of filled bins instead of the
+ * number of bins. This allows working with high-resolution coincidence
+ * matrices (e.g. 16k x 16k), which are usually only sparsely populated,
+ * without ever creating a dense TH2. Bins are numbered as in ROOT, i.e.
+ * 1 ... N, and under- and overflow bins are ignored.
+ */
+class SparseMatrix : public VMatrix {
+public:
+  enum ProjAxis_t { PROJ_X, PROJ_Y };
+
+  SparseMatrix(THnSparse *hist, ProjAxis_t paxis);
+  SparseMatrix(TH2 *hist, ProjAxis_t paxis);
+  ~SparseMatrix() override = default;
+
+  int FindCutBin(double x) override { return fCutAxis.FindFixBin(x); }
+
+  int GetCutLowBin() override { return 1; }
+  int GetCutHighBin() override { return fCutAxis.GetNbins(); }
+
+  double GetProjXmin() override { return fProjAxis.GetXmin(); }
+  double GetProjXmax() override { return fProjAxis.GetXmax(); }
+  int GetProjXbins() override { return fProjAxis.GetNbins(); }
+
+  void AddLine(TArrayD &dst, int l) override;
+
+  TH1 *Projection(const char *histname, const char *histtitle);
+
+  //! Number of non-empty bins stored
+  std::size_t GetNFilled() const { return fLines.GetNFilled(); }
+
+private:
+  TAxis fCutAxis, fProjAxis;
+  SparseRows fLines; //! rows are the lines of the cut axis
 };
 
 #endif
@@ -103,6 +103,7 @@ static int mprojint(MFILE *dstx, MFILE *dsty, unsigned int level, MFILE *src) {
 
   int columns;
   int lines;
+  int tri;
 
   mgetinfo(src, &info);
   columns = info.columns;
@@ -110,6 +111,10 @@ static int mprojint(MFILE *dstx, MFILE *dsty, unsigned int level, MFILE *src) {
   if (level >= info.levels)
     goto errexit;
 
+  /* Symmetric matrices stored as lower triangle */
+  tri = (src->filetype == MAT_LE2T || src->filetype == MAT_LE4T || src->filetype == MAT_HE2T ||
+         src->filetype == MAT_HE4T);
+
   lbuf = (int *)malloc(columns * sizeof(int));
   if (dstx)
     prx = (int *)malloc(columns * sizeof(int));
@@ -131,6 +136,20 @@ static int mprojint(MFILE *dstx, MFILE *dsty, unsigned int level, MFILE *src) {
       if (mgetint(src, lbuf, level, l, 0, columns) != columns)
         goto errexit;
 
+      if (tri) {
+        /* Line l holds M(l, 0..l); by symmetry, M(0..l-1, l) contributes the
+           same counts to channel l. Both projections are identical. */
+        int *proj = prx ? prx : pry;
+        if (proj) {
+          for (c = 0; c < l; c++) {
+            proj[c] += lbuf[c];
+            proj[l] += lbuf[c];
+          }
+          proj[l] += lbuf[l];
+        }
+        continue;
+      }
+
       if (prx) {
         for (c = 0; c < columns; c++) {
           prx[c] += lbuf[c];
@@ -144,6 +163,9 @@ static int mprojint(MFILE *dstx, MFILE *dsty, unsigned int level, MFILE *src) {
         pry[l] += sum;
       }
     }
+
+    if (tri && prx && pry)
+      memcpy(pry, prx, lines * sizeof(int));
   }
 
   free(lbuf);
@@ -272,7 +272,31 @@ class SpecReader:
             return hist
 
     @staticmethod
-    def GetMatrix(fname, fmt=None, histname=None, histtitle=None):
+    def GetMatrix(
+        fname,
+        fmt=None,
+        histname=None,
+        histtitle=None,
+        xwindow=None,
+        ywindow=None,
+        xrebin=1,
+        yrebin=1,
+    ):
+        """
+        Load a matrix into a TH2D. Optionally, only the channel window
+        xwindow = (col1, col2), ywindow = (line1, line2) is loaded, and
+        xrebin x yrebin channels are summed into one bin while reading, so
+        that the matrix never exists in memory at full resolution.
+        """
+        # The C++ side takes unsigned channels, so catch these early
+        for axis, window in (("x", xwindow), ("y", ywindow)):
+            if window is not None and not 0 <= window[0] <= window[1]:
+                raise SpecReaderError(
+                    "Invalid %s window %d - %d" % (axis, window[0], window[1])
+                )
+        if xrebin < 1 or yrebin < 1:
+            raise SpecReaderError("Rebin factors must be positive")
+
         if histname is None:
             histname = os.path.basename(fname)
         if histtitle is None:
@@ -287,16 +311,24 @@ class SpecReader:
             mhist.Open(fname, fmt)
 
         # FIXME: this ignores possibly specified bin errors
-        hist = mhist.ToTH2D(histname, histtitle, 0)
+        if xwindow is None and ywindow is None and xrebin == 1 and yrebin == 1:
+            hist = mhist.ToTH2D(histname, histtitle, 0)
+        else:
+            col1, col2 = xwindow or (0, mhist.GetNColumns() - 1)
+            line1, line2 = ywindow or (0, mhist.GetNLines() - 1)
+            hist = mhist.ToTH2D(
+                histname, histtitle, 0, col1, col2, line1, line2, xrebin, yrebin
+            )
         if not hist:
             raise SpecReaderError(mhist.GetErrorMsg())
         return hist
 
     @staticmethod
-    def GetVMatrix(fname, fmt=None, histname=None, histtitle=None):
+    def GetVMatrix(fname, fmt=None, histname=None, histtitle=None, columns=False):
         """
         Load a ``virtual'' matrix, i.e. a matrix that is not completely loaded
-        into memory.
+        into memory. With columns=True, cuts are placed on the columns
+        instead of the lines of the matrix.
         """
         if histname is None:
             histname = os.path.basename(fname)
@@ -312,7 +344,7 @@ class SpecReader:
             mhist.Open(fname, fmt)
 
         # FIXME: this ignores possibly specified bin errors
-        return ROOT.MFMatrix(mhist, 0)
+        return ROOT.MFMatrix(mhist, 0, columns)
 
     @staticmethod
     def WriteSpectrum(hist, fname, fmt):
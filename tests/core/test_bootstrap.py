@@ -0,0 +1,81 @@
+# HDTV - A ROOT-based spectrum analysis software
+#  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+#
+# This file is part of HDTV.
+#
+# HDTV is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation; either version 2 of the License, or (at your
+# option) any later version.
+#
+# HDTV is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with HDTV; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+
+import pytest
+import ROOT
+
+import hdtv.rootext.fit
+from tests.helpers.create_test_spectrum import make_spectrum
+
+Fit = ROOT.HDTV.Fit
+
+
+@pytest.fixture
+def fitted():
+    # Deterministic spectrum: a gaussian peak on a constant background
+    sigma, vol, pos, bg = 3.0, 2000.0, 100.0, 10.0
+    hist = make_spectrum("bootstrap", [(pos, vol, sigma)], bg=bg)
+
+    fitter = Fit.TheuerkaufFitter(
+        80.0,
+        120.0,
+        Fit.Option(bool)(False),
+        Fit.Option(str)("normal"),
+        Fit.Option(bool)(False),
+    )
+    fitter.AddPeak(
+        Fit.TheuerkaufPeak(
+            fitter.AllocParam(pos), fitter.AllocParam(), fitter.AllocParam()
+        )
+    )
+    fitter.Fit(hist, 1)
+    yield fitter, hist
+
+
+@pytest.mark.parametrize("mode", ["kPoisson", "kParametric"])
+def test_bootstrap_errors(fitted, mode):
+    fitter, hist = fitted
+    peak = fitter.GetPeak(0)
+    boot = Fit.Bootstrap(fitter, hist, getattr(Fit.Bootstrap, mode))
+    assert boot.Run(200, 1) >= 190
+    assert boot.GetNumReplicas() == 200
+
+    # For a well-populated peak, the spread agrees with the fit errors
+    for name, value, error in [
+        ("pos", peak.GetPos(), peak.GetPosError()),
+        ("vol", peak.GetVol(), peak.GetVolError()),
+        ("width", peak.GetSigma(), peak.GetSigmaError()),
+    ]:
+        assert boot.GetMean(0, name) == pytest.approx(value, abs=error)
+        assert boot.GetStdDev(0, name) == pytest.approx(error, rel=0.3)
+        lower = boot.GetPercentile(0, name, 0.16)
+        upper = boot.GetPercentile(0, name, 0.84)
+        assert lower < value < upper
+        assert boot.GetPercentile(0, name, 0.0) == min(boot.GetSamples(0, name))
+
+
+def test_bootstrap_reproducible(fitted):
+    fitter, hist = fitted
+    samples = []
+    for threads in (1, 4):
+        boot = Fit.Bootstrap(fitter, hist)
+        boot.Run(20, 7, threads)
+        samples.append(list(boot.GetSamples(0, "vol")))
+    assert samples[0] == samples[1]
+    assert len(samples[0]) == 20
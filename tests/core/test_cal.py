@@ -0,0 +1,50 @@
+# HDTV - A ROOT-based spectrum analysis software
+#  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+#
+# This file is part of HDTV.
+#
+# HDTV is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation; either version 2 of the License, or (at your
+# option) any later version.
+#
+# HDTV is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with HDTV; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+
+import pytest
+import ROOT
+
+import hdtv.cal
+
+
+@pytest.mark.parametrize(
+    "coeffs",
+    [[], [10.0, 0.5], [1.0, 0.5, 1e-5], [-3.0, 1.2, -2e-5, 1e-9]],
+)
+def test_batch_conversion(coeffs):
+    cal = hdtv.cal.MakeCalibration(coeffs)
+    channels = ROOT.std.vector("double")([0.1 * i**1.5 for i in range(200)])
+
+    energies = cal.Ch2E(channels)
+    back = cal.E2Ch(energies)
+
+    for ch, e, b in zip(channels, energies, back):
+        assert e == pytest.approx(cal.Ch2E(ch), rel=1e-12)
+        assert b == pytest.approx(cal.E2Ch(e), rel=1e-9, abs=1e-9)
+        assert b == pytest.approx(ch, rel=1e-9, abs=1e-9)
+
+
+def test_apply():
+    cal = hdtv.cal.MakeCalibration([2.0, 0.5, 1e-4])
+    axis = ROOT.TAxis()
+
+    cal.Apply(axis, 100)
+
+    for i in range(100):
+        assert axis.GetBinCenter(i + 1) == pytest.approx(cal.Ch2E(i))
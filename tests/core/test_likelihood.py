@@ -0,0 +1,56 @@
+# HDTV - A ROOT-based spectrum analysis software
+#  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+#
+# This file is part of HDTV.
+#
+# HDTV is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation; either version 2 of the License, or (at your
+# option) any later version.
+#
+# HDTV is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with HDTV; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+
+import pytest
+import ROOT
+
+import hdtv.rootext.fit
+from tests.helpers.create_test_spectrum import make_spectrum
+
+Fit = ROOT.HDTV.Fit
+
+
+def fit_background(likelihood, integrate):
+    # A linear background with a peak between the two background regions,
+    # which hold 2 * 41 bins
+    hist = make_spectrum(
+        "bg_%s_%s" % (likelihood, integrate),
+        [(100.0, 20000.0, 3.0)],
+        bg=lambda x: 100.0 + 0.2 * x,
+    )
+    bg = Fit.PolyBg(2, Fit.Option(bool)(integrate), Fit.Option(str)(likelihood))
+    bg.AddRegion(19.5, 60.5)
+    bg.AddRegion(139.5, 180.5)
+    bg.Fit(hist)
+    return bg
+
+
+@pytest.mark.parametrize("integrate", [False, True])
+def test_poisson_background_regions(integrate):
+    normal = fit_background("normal", integrate)
+    poisson = fit_background("poisson", integrate)
+
+    # Like TH1::Fit, the poisson fit leaves out the bins between the regions,
+    # which the background function rejects
+    assert poisson.GetFunc().GetNDF() == normal.GetFunc().GetNDF()
+    assert poisson.GetFunc().GetNDF() <= 2 * 41 - 2
+    assert poisson.GetChisquare() == pytest.approx(0.0, abs=1e-3)
+    assert normal.GetChisquare() == pytest.approx(0.0, abs=1e-3)
+    assert poisson.GetCoeff(0) == pytest.approx(100.0, rel=1e-3)
+    assert poisson.GetCoeff(1) == pytest.approx(0.2, rel=1e-3)
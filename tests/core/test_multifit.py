@@ -0,0 +1,140 @@
+# HDTV - A ROOT-based spectrum analysis software
+#  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+#
+# This file is part of HDTV.
+#
+# HDTV is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation; either version 2 of the License, or (at your
+# option) any later version.
+#
+# HDTV is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with HDTV; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+
+import math
+
+import pytest
+import ROOT
+
+import hdtv.rootext.fit
+from tests.helpers.create_test_spectrum import make_spectrum
+
+Fit = ROOT.HDTV.Fit
+
+
+def make_fitter(positions):
+    fitter = Fit.TheuerkaufFitter(
+        60.0,
+        140.0,
+        Fit.Option(bool)(False),
+        Fit.Option(str)("normal"),
+        Fit.Option(bool)(False),
+    )
+    sigma = fitter.AllocParam()
+    for pos in positions:
+        fitter.AddPeak(
+            Fit.TheuerkaufPeak(fitter.AllocParam(pos), fitter.AllocParam(), sigma)
+        )
+    return fitter
+
+
+@pytest.mark.parametrize("likelihood", ["normal", "poisson"])
+def test_shared_width(likelihood):
+    sigma = 2.5
+    spectra = [
+        make_spectrum("multi0", [(90.0, 5000.0, sigma), (105.0, 2000.0, sigma)]),
+        make_spectrum("multi1", [(90.5, 800.0, sigma), (105.5, 3000.0, sigma)]),
+        make_spectrum("multi2", [(89.5, 1500.0, sigma), (104.5, 1500.0, sigma)]),
+    ]
+    fitters = [make_fitter([90.0, 105.0]) for _ in spectra]
+
+    multi = Fit.MultiFitter(Fit.Option(bool)(False), Fit.Option(str)(likelihood))
+    for fitter, hist in zip(fitters, spectra):
+        assert multi.AddSpectrum(fitter, hist, 1)
+    assert multi.Share("width")
+    assert not multi.Share("vol")
+    multi.Fit()
+
+    # One width, plus position, volume and background per peak and spectrum
+    assert multi.GetNumParams() == 1 + 3 * (2 * 2 + 1)
+    for fitter in fitters:
+        assert fitter.IsFinal()
+        assert fitter.GetPeak(0).GetSigma() == pytest.approx(sigma, rel=1e-3)
+        assert fitter.GetPeak(1).GetSigma() == fitters[0].GetPeak(1).GetSigma()
+    assert fitters[1].GetPeak(0).GetPos() == pytest.approx(90.5, abs=1e-3)
+    assert fitters[1].GetPeak(1).GetVol() == pytest.approx(3000.0, rel=1e-3)
+
+
+def test_shared_offset():
+    sigma = 2.5
+    shifts = [0.0, 1.2, -0.6]
+    spectra = [
+        make_spectrum(
+            "offset%d" % i,
+            [(90.0 + shift, 3000.0, sigma), (105.0 + shift, 2000.0, sigma)],
+        )
+        for i, shift in enumerate(shifts)
+    ]
+    fitters = [make_fitter([90.0, 105.0]) for _ in spectra]
+
+    multi = Fit.MultiFitter(Fit.Option(bool)(False), Fit.Option(str)("normal"))
+    for fitter, hist in zip(fitters, spectra):
+        assert multi.AddSpectrum(fitter, hist, 1)
+    assert multi.Share("offset")
+    assert multi.Share("width")
+    multi.Fit()
+
+    # Two positions, an offset for all but the first spectrum and one width,
+    # plus volumes and background per spectrum
+    assert multi.GetNumParams() == 2 + 2 + 1 + 3 * (2 + 1)
+    for fitter, shift in zip(fitters, shifts):
+        for i, pos in enumerate([90.0, 105.0]):
+            assert fitter.GetPeak(i).GetPos() == pytest.approx(pos + shift, abs=1e-3)
+            assert 0.0 < fitter.GetPeak(i).GetPosError() < 1.0
+
+
+def test_shared_width_model():
+    sigma = 2.5
+    fwhm = 2.0 * math.sqrt(2.0 * math.log(2.0)) * sigma
+    spectra = [
+        make_spectrum("model0", [(90.0, 5000.0, sigma), (105.0, 2000.0, sigma)]),
+        make_spectrum("model1", [(95.0, 3000.0, sigma)]),
+    ]
+    fitters = []
+    for positions in ([90.0, 105.0], [95.0]):
+        fitter = Fit.TheuerkaufFitter(
+            60.0,
+            140.0,
+            Fit.Option(bool)(False),
+            Fit.Option(str)("normal"),
+            Fit.Option(bool)(False),
+        )
+        fixed = Fit.Param.Fixed(0.0)
+        fitter.SetWidthModel(Fit.WidthModel(fitter.AllocParam(), fixed, fixed))
+        for pos in positions:
+            fitter.AddPeak(
+                Fit.TheuerkaufPeak(
+                    fitter.AllocParam(pos), fitter.AllocParam(), Fit.Param.Empty()
+                )
+            )
+        fitters.append(fitter)
+
+    multi = Fit.MultiFitter(Fit.Option(bool)(False), Fit.Option(str)("normal"))
+    for fitter, hist in zip(fitters, spectra):
+        assert multi.AddSpectrum(fitter, hist, 1)
+    assert multi.Share("width")
+    multi.Fit()
+
+    # The width model is shared although the number of peaks differs
+    assert multi.GetNumParams() == 1 + (2 * 2 + 1) + (2 + 1)
+    for fitter in fitters:
+        assert fitter.GetWidthCoeff(0) == pytest.approx(fwhm**2, rel=1e-3)
+        assert fitter.GetPeak(0).GetSigma() == pytest.approx(sigma, rel=1e-3)
+        assert 0.0 < fitter.GetPeak(0).GetSigmaError() < sigma
+    assert fitters[1].GetWidthCoeff(0) == fitters[0].GetWidthCoeff(0)
@@ -0,0 +1,163 @@
+# HDTV - A ROOT-based spectrum analysis software
+#  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+#
+# This file is part of HDTV.
+#
+# HDTV is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation; either version 2 of the License, or (at your
+# option) any later version.
+#
+# HDTV is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with HDTV; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+
+import math
+import os
+
+import pytest
+import ROOT
+
+import hdtv.rootext.calibration
+import hdtv.rootext.fit
+from hdtv.specreader import SpecReader
+from tests.helpers.create_test_spectrum import make_spectrum
+
+Fit = ROOT.HDTV.Fit
+
+
+PEAKS = [(300.0, 20000.0, 3.0), (800.0, 8000.0, 3.0), (1500.0, 40000.0, 3.0)]
+
+
+def test_single_peaks():
+    hist = make_spectrum("pf_single", PEAKS, nbins=2000, bg=50.0)
+    finder = Fit.PeakFinder(3.0, 0.05)
+    assert finder.Search(hist, 0.0, 2000.0) == 3
+
+    for i, (pos, vol, sigma) in enumerate(PEAKS):
+        peak = finder.GetPeak(i)
+        assert peak.GetPos() == pytest.approx(pos, abs=0.3)
+        assert peak.GetVol() == pytest.approx(vol, rel=0.1)
+        assert peak.GetSigma() == pytest.approx(sigma)
+        assert peak.GetBackground() == pytest.approx(50.0, rel=0.2)
+    assert finder.GetNumGroups() == 3
+
+
+def test_threshold():
+    hist = make_spectrum("pf_threshold", PEAKS, nbins=2000, bg=50.0)
+    finder = Fit.PeakFinder(3.0, 0.3)
+    finder.Search(hist, 0.0, 2000.0)
+
+    # The threshold is relative to the highest peak
+    assert [finder.GetPeak(i).GetPos() for i in range(finder.GetNumPeaks())] == [
+        pytest.approx(300.0, abs=0.3),
+        pytest.approx(1500.0, abs=0.3),
+    ]
+
+
+def test_doublet_group():
+    hist = make_spectrum(
+        "pf_doublet",
+        [(1000.0, 20000.0, 3.0), (1010.0, 10000.0, 3.0)],
+        nbins=2000,
+        bg=50.0,
+    )
+    finder = Fit.PeakFinder(3.0, 0.05)
+    assert finder.Search(hist, 0.0, 2000.0) == 2
+
+    assert finder.GetNumGroups() == 1
+    group = finder.GetGroup(0)
+    assert group.GetNumPeaks() == 2
+    assert group.GetMin() == pytest.approx(1000.0 - 2.5 * 3.0, abs=1.5)
+    assert group.GetMax() == pytest.approx(1010.0 + 2.5 * 3.0, abs=1.5)
+
+
+def test_calibrated_sigma():
+    hist = make_spectrum("pf_cal", [(1000.0, 20000.0, 4.0)], nbins=2000, bg=50.0)
+    finder = Fit.PeakFinder(2.0, 0.05)
+    finder.SetCalibration(ROOT.HDTV.Calibration(0.0, 0.5))
+    assert finder.Search(hist, 0.0, 2000.0) == 1
+
+    # Sigma is given in energy units and converted to channels
+    assert finder.GetPeak(0).GetSigma() == pytest.approx(4.0)
+    assert finder.GetPeak(0).GetPos() == pytest.approx(1000.0, abs=0.3)
+
+
+def test_empty_region():
+    hist = make_spectrum("pf_empty", PEAKS, nbins=2000, bg=50.0)
+    finder = Fit.PeakFinder(3.0, 0.05)
+    assert finder.Search(hist, 400.0, 700.0) == 0
+    assert finder.GetNumGroups() == 0
+
+
+def test_no_spurious_peaks():
+    # Without a threshold, only the significance cut keeps noise out
+    rng = ROOT.TRandom3(42)
+    for i in range(20):
+        hist = make_spectrum("pf_noise%d" % i, PEAKS, nbins=2000, bg=50.0)
+        for b in range(1, hist.GetNbinsX() + 1):
+            n = rng.Poisson(hist.GetBinContent(b))
+            hist.SetBinContent(b, n)
+            hist.SetBinError(b, math.sqrt(n))
+        finder = Fit.PeakFinder(3.0, 0.0)
+        finder.Search(hist, 0.0, 2000.0)
+        assert [finder.GetPeak(k).GetPos() for k in range(finder.GetNumPeaks())] == [
+            pytest.approx(pos, abs=1.0) for pos, _, _ in PEAKS
+        ]
+
+
+# Background lines of osiris_bg.spc (keV, about one channel each)
+OSIRIS_LINES = [
+    186.0,  # 226Ra 186.2, 235U 185.7
+    238.6,  # 212Pb
+    270.2,  # 228Ac
+    295.2,  # 214Pb
+    338.3,  # 228Ac
+    351.9,  # 214Pb
+    463.0,  # 228Ac
+    511.0,  # annihilation, 208Tl 510.8
+    583.2,  # 208Tl
+    609.3,  # 214Bi
+    665.4,  # 214Bi
+    727.3,  # 212Bi
+    768.4,  # 214Bi
+    785.5,  # 212Pb 785.4, 214Bi 786.0
+    794.9,  # 228Ac
+    846.8,  # 56Fe(n,n')
+    860.6,  # 208Tl
+    911.2,  # 228Ac
+    934.1,  # 214Bi
+    969.0,  # 228Ac
+    1120.3,  # 214Bi
+    1155.2,  # 214Bi
+    1173.2,  # 60Co
+    1238.1,  # 214Bi
+    1281.0,  # 214Bi
+    1332.5,  # 60Co
+    1377.7,  # 214Bi
+    1408.0,  # 214Bi
+    1460.8,  # 40K
+    1509.2,  # 214Bi
+    1729.6,  # 214Bi
+    1764.5,  # 214Bi
+    1847.4,  # 214Bi
+    2204.1,  # 214Bi
+    2614.5,  # 208Tl
+]
+
+
+def test_reference_lines():
+    path = os.path.join(os.path.curdir, "tests", "share", "osiris_bg.spc")
+    hist = SpecReader.GetSpectrum(path, histname="pf_osiris")
+    finder = Fit.PeakFinder(2.5, 0.02)
+    finder.Search(hist, 100.0, 3000.0)
+
+    # All known lines, and nothing else, at their energies
+    assert [finder.GetPeak(i).GetPos() for i in range(finder.GetNumPeaks())] == [
+        pytest.approx(energy, abs=1.0) for energy in OSIRIS_LINES
+    ]
@@ -0,0 +1,92 @@
+# HDTV - A ROOT-based spectrum analysis software
+#  Copyright (C) 2006-2009  The HDTV development team (see file AUTHORS)
+#
+# This file is part of HDTV.
+#
+# HDTV is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation; either version 2 of the License, or (at your
+# option) any later version.
+#
+# HDTV is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with HDTV; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+
+import pytest
+import ROOT
+
+import hdtv.rootext.fit
+from tests.helpers.create_test_spectrum import make_spectrum, theuerkauf
+
+Fit = ROOT.HDTV.Fit
+
+
+def make_fitter(positions, tails=False, inipar=True):
+    # With debugShowInipar, the fitter stops after estimating the parameters
+    fitter = Fit.TheuerkaufFitter(
+        60.0,
+        140.0,
+        Fit.Option(bool)(False),
+        Fit.Option(str)("normal"),
+        Fit.Option(bool)(False),
+        inipar,
+    )
+    for pos in positions:
+        tl = fitter.AllocParam() if tails else Fit.Param.Empty()
+        fitter.AddPeak(
+            Fit.TheuerkaufPeak(
+                fitter.AllocParam(pos), fitter.AllocParam(), fitter.AllocParam(), tl
+            )
+        )
+    return fitter
+
+
+def test_overlapping_peaks():
+    hist = make_spectrum(
+        "init_doublet", [(90.0, 5000.0, 2.5), (97.0, 2000.0, 2.5)], shape=theuerkauf
+    )
+    fitter = make_fitter([91.0, 96.0])
+    fitter.Fit(hist, 1)
+
+    for i, (pos, vol) in enumerate([(90.0, 5000.0), (97.0, 2000.0)]):
+        peak = fitter.GetPeak(i)
+        assert peak.GetPos() == pytest.approx(pos, abs=0.2)
+        assert peak.GetVol() == pytest.approx(vol, rel=0.05)
+        assert peak.GetSigma() == pytest.approx(2.5, rel=0.05)
+
+
+def test_tail_from_skewness():
+    hist = make_spectrum("init_tail", [(100.0, 5000.0, 2.0, 3.0)], shape=theuerkauf)
+    fitter = make_fitter([101.0], tails=True)
+    fitter.Fit(hist, 1)
+
+    peak = fitter.GetPeak(0)
+    assert peak.GetPos() == pytest.approx(100.0, abs=0.1)
+    assert peak.GetSigma() == pytest.approx(2.0, rel=0.05)
+    assert peak.GetLeftTail() == pytest.approx(3.0, rel=0.2)
+
+
+def test_no_tail_for_gaussian():
+    hist = make_spectrum("init_gauss", [(100.0, 5000.0, 2.0)], shape=theuerkauf)
+    fitter = make_fitter([101.0], tails=True)
+    fitter.Fit(hist, 1)
+
+    # Tails that are not seen start far out
+    assert fitter.GetPeak(0).GetLeftTail() == pytest.approx(10.0)
+
+
+def test_fit_from_estimate():
+    hist = make_spectrum(
+        "init_fit", [(90.0, 5000.0, 2.5), (97.0, 2000.0, 2.5)], shape=theuerkauf
+    )
+    fitter = make_fitter([91.0, 96.0], inipar=False)
+    fitter.Fit(hist, 1)
+
+    assert fitter.GetFitStats().GetStatus() == 0
+    assert fitter.GetPeak(0).GetPos() == pytest.approx(90.0, abs=1e-3)
+    assert fitter.GetPeak(1).GetVol() == pytest.approx(2000.0, rel=1e-3)
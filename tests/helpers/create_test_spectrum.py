@@ -17,9 +17,11 @@
 # along with HDTV; if not, write to the Free Software Foundation,
 # Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
 
+import math
 import os
 
 import numpy as np
+import ROOT
 from numpy import arange, exp, log, ones, savetxt
 from numpy.random import poisson
 from scipy.stats import norm
@@ -99,3 +101,40 @@ class ArtificialSpec:
             savetxt(self.filename, spectrum)
 
         return self.filename
+
+
+def gauss(x, pos, vol, sigma):
+    """Gaussian peak of volume vol"""
+    return (
+        vol
+        / (math.sqrt(2 * math.pi) * sigma)
+        * math.exp(-((x - pos) ** 2) / (2 * sigma**2))
+    )
+
+
+def theuerkauf(x, pos, vol, sigma, tl=math.inf):
+    """Theuerkauf peak of volume vol, with a left tail if tl is finite"""
+    norm = math.sqrt(math.pi / 2) * sigma * (1 + math.erf(tl / (math.sqrt(2) * sigma)))
+    if tl < math.inf:
+        norm += sigma**2 / tl * math.exp(-(tl**2) / (2 * sigma**2))
+    dx = x - pos
+    if dx < -tl:
+        return vol / norm * math.exp(tl / sigma**2 * (dx + tl / 2))
+    return vol / norm * math.exp(-(dx**2) / (2 * sigma**2))
+
+
+def make_spectrum(name, peaks, nbins=200, bg=20.0, shape=gauss):
+    """
+    Create a TH1D with nbins bins centered on the channels 0 to nbins - 1,
+    holding the exact (non-fluctuated) counts of the given peaks on a
+    background. Each peak is a tuple of the arguments of shape after x;
+    bg is either constant or a function of x. The errors are the square
+    roots of the counts.
+    """
+    hist = ROOT.TH1D(name, name, nbins, -0.5, nbins - 0.5)
+    for b in range(1, nbins + 1):
+        x = hist.GetBinCenter(b)
+        y = (bg(x) if callable(bg) else bg) + sum(shape(x, *peak) for peak in peaks)
+        hist.SetBinContent(b, y)
+        hist.SetBinError(b, math.sqrt(y))
+    return hist
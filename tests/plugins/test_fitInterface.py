@@ -97,7 +97,7 @@ def test_cmd_fit_peakfind():
     assert len(spec_interface.spectra.dict) == 1
     f, ferr = hdtvcmd("fit peakfind -a -t 0.002")
     assert "Search Peaks in region" in f
-    assert "Found 68 peaks" in f
+    assert "Found 77 peaks" in f
     # This was not needed before commits around ~b41833c9c66f9ba5dbdcfc6fc4468b242360641f
     # However, some small change has happened that prevents a correct fit of a single
     # double peak at ~1540 keV. When I fit it manually, using a similar fit region
@@ -165,6 +165,85 @@ def test_cmd_fit_copy():
     assert workFit.fitter == newFit.fitter
 
 
+@pytest.mark.parametrize("width", ["equal", "free"])
+def test_fit_varpro(width):
+    spec_interface.LoadSpectra(testspectrum)
+    setup_fit()
+    results = {}
+    for varpro in ("False", "True"):
+        f, ferr = hdtvcmd(
+            "fit function peak activate theuerkauf",
+            f"fit parameter width {width}",
+            f"fit parameter varpro {varpro}",
+            "fit execute",
+        )
+        assert "2 peaks in WorkFit" in f
+        peaks = spec_interface.spectra.workFit.peaks
+        results[varpro] = [(p.pos.nominal_value, p.vol.nominal_value) for p in peaks]
+
+    # Both ways must arrive at the same minimum
+    for (pos, vol), (vp_pos, vp_vol) in zip(results["False"], results["True"]):
+        assert vp_pos == pytest.approx(pos, abs=0.01)
+        assert vp_vol == pytest.approx(vol, rel=1e-3)
+
+
+def test_fit_width_model():
+    spec_interface.LoadSpectra(testspectrum)
+    setup_fit()
+    results = {}
+    for width, fwhm_b in (("equal", "free"), ("model", "0")):
+        f, ferr = hdtvcmd(
+            "fit function peak activate theuerkauf",
+            f"fit parameter width {width}",
+            f"fit parameter fwhm_b {fwhm_b}",
+            "fit execute",
+        )
+        assert "2 peaks in WorkFit" in f
+        peaks = spec_interface.spectra.workFit.peaks
+        results[width] = [(p.vol.nominal_value, p.width.nominal_value) for p in peaks]
+
+    # A constant width model is the same as a common width
+    for (vol, width), (m_vol, m_width) in zip(results["equal"], results["model"]):
+        assert m_vol == pytest.approx(vol, rel=1e-3)
+        assert m_width == pytest.approx(width, rel=1e-3)
+
+    # With a linear term, each peak gets its width from the model
+    f, ferr = hdtvcmd("fit parameter fwhm_b free", "fit execute")
+    assert "2 peaks in WorkFit" in f
+    for peak in spec_interface.spectra.workFit.peaks:
+        assert peak.width.nominal_value > 0
+        assert peak.width.std_dev > 0
+
+
+def test_fit_bootstrap():
+    spec_interface.LoadSpectra(testspectrum)
+    setup_fit()
+    f, ferr = hdtvcmd("fit function peak activate theuerkauf", "fit execute")
+    assert "2 peaks in WorkFit" in f
+    f, ferr = hdtvcmd("fit bootstrap -n 20 -j 2")
+    assert ferr == ""
+    assert "of 20 replica fits converged" in f
+    assert "68%" in f
+
+
+def test_fit_profile():
+    spec_interface.LoadSpectra(testspectrum)
+    setup_fit()
+    f, ferr = hdtvcmd(
+        "fit function peak activate theuerkauf",
+        "option set fit.profile True",
+        "fit execute",
+        "fit profile --reset",
+        "option set fit.profile False",
+    )
+    assert ferr == ""
+    assert "TheuerkaufFitter" in f
+    stats = fit_interface.spectra.workFit.fitter.peakFitter.GetFitStats()
+    assert stats.GetNumMinimizations() > 0
+    assert stats.GetNumCalls() > 0
+    assert stats.GetWallTime() > 0.0
+
+
 def test_interpolation_incomplete():
     spec_interface.LoadSpectra(testspectrum)
     assert len(spec_interface.spectra.dict) == 1
@@ -17,9 +17,14 @@
 # along with HDTV; if not, write to the Free Software Foundation,
 # Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
 
+import os
+
 import pytest
+import ROOT
 
+from hdtv.specreader import SpecReader, SpecReaderError
 from hdtv.util import monkey_patch_ui
+from tests.helpers.utils import isclose
 
 monkey_patch_ui()
 
@@ -48,6 +53,163 @@ def prepare():
     spectra.Clear()
 
 
+def test_triangular_matrix(temp_file):
+    n = 16
+    tri = ROOT.TH2D("tri", "tri", n, -0.5, n - 0.5, n, -0.5, n - 0.5)
+    full = ROOT.TH2D("full", "full", n, -0.5, n - 0.5, n, -0.5, n - 0.5)
+    for line in range(n):
+        for col in range(line + 1):
+            z = 1.0 + line * n + col
+            tri.SetBinContent(col + 1, line + 1, z)
+            full.SetBinContent(col + 1, line + 1, z)
+            full.SetBinContent(line + 1, col + 1, z)
+
+    assert ROOT.MFileHist.WriteTH2(tri, temp_file, "le4t") == 0
+    mhist = ROOT.MFileHist()
+    assert mhist.Open(temp_file) == 0
+    assert mhist.IsTriangular()
+
+    # RMatrix bins start at 1, MFMatrix lines at 0
+    mmat = ROOT.MFMatrix(mhist, 0)
+    rmat = ROOT.RMatrix(full, ROOT.RMatrix.PROJ_X)
+    assert mmat.IsSymmetric()
+    mmat.AddCutRegion(3, 6)
+    rmat.AddCutRegion(4, 7)
+    mmat.AddBgRegion(10, 11)
+    rmat.AddBgRegion(11, 12)
+    mcut = mmat.Cut("mcut", "mcut")
+    rcut = rmat.Cut("rcut", "rcut")
+    for b in range(1, n + 1):
+        assert isclose(mcut.GetBinContent(b), rcut.GetBinContent(b))
+
+    for loader in (mhist.ToTH2D, mhist.ToTH2I):
+        mat = loader("mat", "mat", 0)
+        assert mat.GetEntries() == n * n
+        for x in range(1, n + 1):
+            for y in range(1, n + 1):
+                assert mat.GetBinContent(x, y) == full.GetBinContent(x, y)
+
+    prx = temp_file + ".prx"
+    assert ROOT.MatOp.Project(temp_file, prx, "") == ROOT.MatOp.ERR_SUCCESS
+    phist = ROOT.MFileHist()
+    assert phist.Open(prx) == 0
+    proj = phist.ToTH1D("proj", "proj", 0, 0)
+    os.remove(prx)
+    for b in range(1, n + 1):
+        assert isclose(proj.GetBinContent(b), full.Integral(b, b, 1, n))
+
+
+@pytest.mark.parametrize("fmt", ["le4", "le4t"])
+@pytest.mark.parametrize(
+    "xwindow, ywindow, xrebin, yrebin",
+    [((0, 15), (0, 15), 2, 4), ((3, 12), (5, 14), 1, 1), ((2, 14), (1, 8), 3, 2)],
+)
+def test_matrix_window_rebin(temp_file, fmt, xwindow, ywindow, xrebin, yrebin):
+    n = 16
+    stored = ROOT.TH2D("stored", "stored", n, -0.5, n - 0.5, n, -0.5, n - 0.5)
+    full = ROOT.TH2D("full", "full", n, -0.5, n - 0.5, n, -0.5, n - 0.5)
+    for line in range(n):
+        for col in range(n):
+            if fmt == "le4t":
+                z = 1.0 + max(line, col) * n + min(line, col)
+                if col <= line:
+                    stored.SetBinContent(col + 1, line + 1, z)
+            else:
+                z = 1.0 + line * n + col
+                stored.SetBinContent(col + 1, line + 1, z)
+            full.SetBinContent(col + 1, line + 1, z)
+
+    assert ROOT.MFileHist.WriteTH2(stored, temp_file, fmt) == 0
+    mhist = ROOT.MFileHist()
+    assert mhist.Open(temp_file) == 0
+    mat = mhist.ToTH2D("mat", "mat", 0, *xwindow, *ywindow, xrebin, yrebin)
+    assert mat
+
+    nx = (xwindow[1] - xwindow[0] + 1) // xrebin
+    ny = (ywindow[1] - ywindow[0] + 1) // yrebin
+    assert mat.GetNbinsX() == nx
+    assert mat.GetNbinsY() == ny
+    assert isclose(mat.GetXaxis().GetXmin(), xwindow[0] - 0.5)
+    assert isclose(mat.GetYaxis().GetXmin(), ywindow[0] - 0.5)
+    for bx in range(nx):
+        for by in range(ny):
+            x1 = xwindow[0] + bx * xrebin + 1
+            y1 = ywindow[0] + by * yrebin + 1
+            expected = full.Integral(x1, x1 + xrebin - 1, y1, y1 + yrebin - 1)
+            assert mat.GetBinContent(bx + 1, by + 1) == expected
+
+
+def test_mfmatrix_cut(temp_file):
+    # More lines than the read-ahead buffer holds
+    n = 64
+    full = ROOT.TH2D("full", "full", n, -0.5, n - 0.5, n, -0.5, n - 0.5)
+    for line in range(n):
+        for col in range(n):
+            full.SetBinContent(col + 1, line + 1, 1.0 + (line * 7 + col * 3) % 11)
+
+    assert ROOT.MFileHist.WriteTH2(full, temp_file, "le4") == 0
+    mhist = ROOT.MFileHist()
+    assert mhist.Open(temp_file) == 0
+
+    mmat = ROOT.MFMatrix(mhist, 0)
+    rmat = ROOT.RMatrix(full, ROOT.RMatrix.PROJ_X)
+    for c1, c2 in [(2, 5), (10, 50)]:
+        mmat.AddCutRegion(c1, c2)
+        rmat.AddCutRegion(c1 + 1, c2 + 1)
+    mmat.AddBgRegion(55, 60)
+    rmat.AddBgRegion(56, 61)
+    mcut = mmat.Cut("mcut", "mcut")
+    rcut = rmat.Cut("rcut", "rcut")
+    for b in range(1, n + 1):
+        assert isclose(mcut.GetBinContent(b), rcut.GetBinContent(b))
+
+
+def test_mfmatrix_column_cut(temp_file):
+    # Asymmetric and not square, so that mixing up lines and columns shows
+    lines, cols = 24, 40
+    full = ROOT.TH2D("full", "full", cols, -0.5, cols - 0.5, lines, -0.5, lines - 0.5)
+    for line in range(lines):
+        for col in range(cols):
+            full.SetBinContent(col + 1, line + 1, 1.0 + (line * 7 + col * 3) % 11)
+
+    assert ROOT.MFileHist.WriteTH2(full, temp_file, "le4") == 0
+    mhist = ROOT.MFileHist()
+    assert mhist.Open(temp_file) == 0
+
+    mmat = ROOT.MFMatrix(mhist, 0, True)
+    rmat = ROOT.RMatrix(full, ROOT.RMatrix.PROJ_Y)
+    assert mmat.IsColumnCut()
+    assert mmat.GetCutHighBin() == cols - 1
+    assert mmat.GetProjXbins() == lines
+
+    # Second cut reuses cached columns and adds new ones
+    for regions, bg in [([(2, 5), (30, 33)], (36, 38)), ([(3, 8)], (20, 22))]:
+        mmat.ResetRegions()
+        rmat.ResetRegions()
+        for c1, c2 in regions:
+            mmat.AddCutRegion(c1, c2)
+            rmat.AddCutRegion(c1 + 1, c2 + 1)
+        mmat.AddBgRegion(*bg)
+        rmat.AddBgRegion(bg[0] + 1, bg[1] + 1)
+        mcut = mmat.Cut("mcut", "mcut")
+        rcut = rmat.Cut("rcut", "rcut")
+        assert mcut.GetNbinsX() == lines
+        for b in range(1, lines + 1):
+            assert isclose(mcut.GetBinContent(b), rcut.GetBinContent(b))
+
+
+@pytest.mark.parametrize(
+    "xwindow, ywindow, xrebin",
+    [((-1, 7), None, 1), (None, (9, 3), 1), (None, None, 0)],
+)
+def test_matrix_window_invalid(temp_file, xwindow, ywindow, xrebin):
+    n = 16
+    stored = ROOT.TH2D("stored", "stored", n, -0.5, n - 0.5, n, -0.5, n - 0.5)
+    assert ROOT.MFileHist.WriteTH2(stored, temp_file, "le4") == 0
+    with pytest.raises(SpecReaderError):
+        SpecReader.GetMatrix(temp_file, xwindow=xwindow, ywindow=ywindow, xrebin=xrebin)
+
+
 @pytest.mark.skip(reason="need example matrix")
 def test_cmd_matrix_get_sym(matrix):
     raise NotImplementedError
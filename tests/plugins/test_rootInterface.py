@@ -18,8 +18,10 @@
 # Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
 
 import os
+from array import array
 
 import pytest
+import ROOT
 
 from hdtv.util import monkey_patch_ui
 from tests.helpers.utils import hdtvcmd, isclose
@@ -129,6 +131,41 @@ def test_root_to_root_conversion_for_unconventional_binning():
     assert isclose(get_spec(1).cal.GetCoeffs()[1], 0.5)
 
 
+@pytest.mark.parametrize("paxis", ["PROJ_X", "PROJ_Y"])
+def test_sparse_matrix_matches_dense(paxis):
+    nbins = array("i", [64, 32])
+    xmin = array("d", [0.0, -16.0])
+    xmax = array("d", [64.0, 16.0])
+    sparse = ROOT.THnSparseD("sparse", "sparse", 2, nbins, xmin, xmax)
+    dense = ROOT.TH2D("dense", "dense", 64, 0.0, 64.0, 32, -16.0, 16.0)
+    for i in range(200):
+        x = (i * 37) % 64 + 0.5
+        y = (i * 11) % 32 - 15.5
+        sparse.Fill(array("d", [x, y]), i + 1.0)
+        dense.Fill(x, y, i + 1.0)
+
+    smat = ROOT.SparseMatrix(sparse, getattr(ROOT.SparseMatrix, paxis))
+    dmat = ROOT.RMatrix(dense, getattr(ROOT.RMatrix, paxis))
+    assert not smat.Failed()
+    assert smat.GetNFilled() == sparse.GetNbins()
+    assert smat.GetProjXbins() == dmat.GetProjXbins()
+
+    for m in (smat, dmat):
+        m.AddCutRegion(m.FindCutBin(2.0), m.FindCutBin(5.0))
+        m.AddBgRegion(m.FindCutBin(10.0), m.FindCutBin(12.0))
+    scut = smat.Cut("scut", "scut")
+    dcut = dmat.Cut("dcut", "dcut")
+    sproj = smat.Projection("sproj", "sproj")
+    if paxis == "PROJ_X":
+        dproj = dense.ProjectionX("dproj")
+    else:
+        dproj = dense.ProjectionY("dproj")
+
+    for b in range(1, smat.GetProjXbins() + 1):
+        assert isclose(scut.GetBinContent(b), dcut.GetBinContent(b))
+        assert isclose(sproj.GetBinContent(b), dproj.GetBinContent(b))
+
+
 def get_spec(specid):
     s = hdtv.plugins.specInterface.spec_interface
     return s.spectra.dict.get([x for x in list(s.spectra.dict) if x.major == specid][0])